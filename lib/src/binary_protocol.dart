@@ -0,0 +1,83 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+/// Channel carrying the high-frequency calls and events as compact binary
+/// records, see linux/BinaryProtocol.h for the record layouts.
+const binaryChannelName = 'flutter_webkit/binary';
+
+const opSetDimension = 0x01;
+const opEvaluateJavascript = 0x02;
+
+const eventJavascriptResult = 0x81;
+const eventLoadProgress = 0x82;
+const eventLoadChanged = 0x83;
+
+/// Builds a little endian record starting with [opcode].
+class BinaryWriter {
+  final _builder = BytesBuilder();
+  final _scratch = ByteData(8);
+
+  BinaryWriter(int opcode) {
+    u8(opcode);
+  }
+
+  void u8(int value) => _builder.addByte(value);
+
+  void i32(int value) {
+    _scratch.setInt32(0, value, Endian.little);
+    _builder.add(_scratch.buffer.asUint8List(0, 4));
+  }
+
+  void u64(int value) {
+    _scratch.setUint64(0, value, Endian.little);
+    _builder.add(_scratch.buffer.asUint8List(0, 8));
+  }
+
+  void bytes(List<int> value) => _builder.add(value);
+
+  ByteData finish() => ByteData.sublistView(_builder.takeBytes());
+}
+
+/// Reads a record written by the native side, throws a [RangeError] when the
+/// record is shorter than expected.
+class BinaryReader {
+  final ByteData _data;
+  int _offset = 0;
+
+  BinaryReader(this._data);
+
+  int u8() => _data.getUint8(_offset++);
+
+  int i32() {
+    final value = _data.getInt32(_offset, Endian.little);
+    _offset += 4;
+    return value;
+  }
+
+  int u32() {
+    final value = _data.getUint32(_offset, Endian.little);
+    _offset += 4;
+    return value;
+  }
+
+  int u64() {
+    final value = _data.getUint64(_offset, Endian.little);
+    _offset += 8;
+    return value;
+  }
+
+  double f64() {
+    final value = _data.getFloat64(_offset, Endian.little);
+    _offset += 8;
+    return value;
+  }
+
+  String string(int length) {
+    final value = utf8.decode(Uint8List.sublistView(
+        _data, _offset, _offset + length));
+    _offset += length;
+    return value;
+  }
+
+  String rest() => string(_data.lengthInBytes - _offset);
+}
@@ -1,3 +1,4 @@
+import 'dart:typed_data';
 import 'dart:ui';
 
 import 'package:flutter_webkit/src/types.dart';
@@ -13,6 +14,30 @@ class FlutterWebkit {
     return FlutterWebkitPlatform.instance.createWebView(args);
   }
 
+  Future<int> getHost() {
+    return FlutterWebkitPlatform.instance.getHost();
+  }
+
+  Future<bool> moveWebView(int webviewId, int host) {
+    return FlutterWebkitPlatform.instance.moveWebView(webviewId, host);
+  }
+
+  Future<bool> startTracing(String path) {
+    return FlutterWebkitPlatform.instance.startTracing(path);
+  }
+
+  Future<String?> stopTracing() {
+    return FlutterWebkitPlatform.instance.stopTracing();
+  }
+
+  Future<List<LogRecord>> getLogs() {
+    return FlutterWebkitPlatform.instance.getLogs();
+  }
+
+  Future<void> setLogLevel(LogCategory? category, LogLevel level) {
+    return FlutterWebkitPlatform.instance.setLogLevel(category, level);
+  }
+
   Future<void> destroyWebView(int webviewId) {
     return FlutterWebkitPlatform.instance.destroyWebView(webviewId);
   }
@@ -21,8 +46,8 @@ class FlutterWebkit {
     return FlutterWebkitPlatform.instance.open(webviewId, uri);
   }
 
-  Future<void> setDimension(int webviewId, Rect rect) {
-    return FlutterWebkitPlatform.instance.setDimension(webviewId, rect);
+  Future<void> setDimension(int webviewId, Rect rect, [Rect? clip]) {
+    return FlutterWebkitPlatform.instance.setDimension(webviewId, rect, clip);
   }
 
   Stream<LoadEvent> getLoadEvents(int webviewId) {
@@ -37,6 +62,14 @@ class FlutterWebkit {
     return FlutterWebkitPlatform.instance.getTitleEvents(webviewId);
   }
 
+  Stream<double> getProgressEvents(int webviewId) {
+    return FlutterWebkitPlatform.instance.getProgressEvents(webviewId);
+  }
+
+  Stream<DownloadEvent> getDownloadEvents(int webviewId) {
+    return FlutterWebkitPlatform.instance.getDownloadEvents(webviewId);
+  }
+
   Future<dynamic> evaluateJavascript(int webviewId, int callId, String script) {
     return FlutterWebkitPlatform.instance
         .evaluateJavascript(webviewId, callId, script);
@@ -46,6 +79,22 @@ class FlutterWebkit {
     return FlutterWebkitPlatform.instance.reload(webviewId, bypassCache);
   }
 
+  Future<bool> goBack(int webviewId) {
+    return FlutterWebkitPlatform.instance.goBack(webviewId);
+  }
+
+  Future<bool> goForward(int webviewId) {
+    return FlutterWebkitPlatform.instance.goForward(webviewId);
+  }
+
+  Future<bool> goToIndex(int webviewId, int index) {
+    return FlutterWebkitPlatform.instance.goToIndex(webviewId, index);
+  }
+
+  Future<BackForwardList> getBackForwardList(int webviewId) {
+    return FlutterWebkitPlatform.instance.getBackForwardList(webviewId);
+  }
+
   Future<bool> registerJavascriptCallback(int webviewId, String name) {
     return FlutterWebkitPlatform.instance
         .registerJavascriptCallback(webviewId, name);
@@ -61,7 +110,92 @@ class FlutterWebkit {
         .getJavascriptCallbackStream(webviewId, name);
   }
 
+  Future<bool> updateSettings(
+      int webviewId, String? preset, Map<String, Object?>? settings) {
+    return FlutterWebkitPlatform.instance
+        .updateSettings(webviewId, preset, settings);
+  }
+
+  Future<void> setHeadlessLimit(int limit) {
+    return FlutterWebkitPlatform.instance.setHeadlessLimit(limit);
+  }
+
+  Future<void> setAdaptiveQuality(bool enabled) {
+    return FlutterWebkitPlatform.instance.setAdaptiveQuality(enabled);
+  }
+
+  Future<QualityTier> getQualityTier(int webviewId) {
+    return FlutterWebkitPlatform.instance.getQualityTier(webviewId);
+  }
+
+  Future<bool> prerender(int webviewId, String uri) {
+    return FlutterWebkitPlatform.instance.prerender(webviewId, uri);
+  }
+
+  Future<void> cancelPrerender(int webviewId, String? uri) {
+    return FlutterWebkitPlatform.instance.cancelPrerender(webviewId, uri);
+  }
+
+  Future<void> setPrerenderLimit(int limit) {
+    return FlutterWebkitPlatform.instance.setPrerenderLimit(limit);
+  }
+
+  Future<void> registerUploadHandler(int webviewId, String name,
+      UploadSink Function(String? contentType) createSink) {
+    return FlutterWebkitPlatform.instance
+        .registerUploadHandler(webviewId, name, createSink);
+  }
+
+  Future<void> registerUploadFile(int webviewId, String name, String path,
+      void Function(int size)? onSaved) {
+    return FlutterWebkitPlatform.instance
+        .registerUploadFile(webviewId, name, path, onSaved);
+  }
+
+  Future<void> unregisterUploadHandler(int webviewId, String name) {
+    return FlutterWebkitPlatform.instance
+        .unregisterUploadHandler(webviewId, name);
+  }
+
+  Future<int> warmUp(List<String> uris) {
+    return FlutterWebkitPlatform.instance.warmUp(uris);
+  }
+
+  Future<WarmUpStats> getWarmUpStats() {
+    return FlutterWebkitPlatform.instance.getWarmUpStats();
+  }
+
+  Future<void> setDownloadRules(
+      List<Map<dynamic, dynamic>> rules,
+      String? defaultDirectory,
+      bool cancelUnmatched,
+      Duration progressInterval) {
+    return FlutterWebkitPlatform.instance.setDownloadRules(
+        rules, defaultDirectory, cancelUnmatched, progressInterval);
+  }
+
+  Future<bool> cancelDownload(int id) {
+    return FlutterWebkitPlatform.instance.cancelDownload(id);
+  }
+
+  Future<Uint8List> snapshot(int webviewId, bool fullDocument) {
+    return FlutterWebkitPlatform.instance.snapshot(webviewId, fullDocument);
+  }
+
+  Future<ResourceTimeline?> getResourceTimeline(int webviewId) {
+    return FlutterWebkitPlatform.instance.getResourceTimeline(webviewId);
+  }
+
   Future<void> openInspector(int webviewId) {
     return FlutterWebkitPlatform.instance.openInspector(webviewId);
   }
+
+  Future<void> setNavigationRules(
+      int webviewId,
+      List<Map<dynamic, dynamic>> rules,
+      NavigationAction defaultAction,
+      Future<NavigationAction> Function(String uri, bool newWindow)? fallback) {
+    return FlutterWebkitPlatform.instance
+        .setNavigationRules(webviewId, rules, defaultAction, fallback);
+  }
 }
@@ -1,10 +1,12 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:typed_data';
 
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 import 'package:flutter_webkit/src/types.dart';
 
+import 'binary_protocol.dart';
 import 'flutter_webkit_platform_interface.dart';
 
 class _WebViewEvent<T> {
@@ -35,63 +37,196 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
   /// The method channel used to interact with the native platform.
   @visibleForTesting
   final methodChannel = const MethodChannel('flutter_webkit');
+
+  /// Channel for the high-frequency calls and events, see
+  /// binary_protocol.dart.
+  @visibleForTesting
+  final binaryChannel =
+      const BasicMessageChannel<ByteData?>(binaryChannelName, BinaryCodec());
   final _loadEventStream =
       StreamController<_WebViewEvent<LoadEvent>>.broadcast();
-  final _jsCallResponseStream =
-      StreamController<_WebViewEvent<_JSCallResponse>>.broadcast();
   final _uriEventStream = StreamController<_WebViewEvent<String?>>.broadcast();
   final _titleEventStream =
       StreamController<_WebViewEvent<String?>>.broadcast();
+  final _progressEventStream =
+      StreamController<_WebViewEvent<double>>.broadcast();
+  final _downloadEventStream =
+      StreamController<_WebViewEvent<DownloadEvent>>.broadcast();
   final _javascriptCallbackStream =
       StreamController<_WebViewEvent<_JSCallback>>.broadcast();
+  final _navigationFallbacks =
+      <int, Future<NavigationAction> Function(String uri, bool newWindow)>{};
+  final _uploadSinkFactories =
+      <int, Map<String, UploadSink Function(String? contentType)>>{};
+  final _uploadFileCallbacks = <int, Map<String, void Function(int size)?>>{};
+  final _uploads = <int, UploadSink>{};
+
+  /// Set in isolates other than the root isolate. Flutter only delivers
+  /// native messages to the root isolate, so views created here have their
+  /// events queued natively and fetched with [_pollEvents].
+  final bool _background = RootIsolateToken.instance == null;
 
   MethodChannelFlutterWebkit() {
-    methodChannel.setMethodCallHandler((call) async {
-      switch (call.method) {
-        case "on_load_changed":
-          final webview = call.arguments["webview"] as int;
-          final e = call.arguments["event"] as int;
-
-          _loadEventStream
-              .add(_WebViewEvent<LoadEvent>(webview, LoadEvent.values[e]));
-          break;
-        case "on_evaluate_javascript_completed":
-          final webview = call.arguments["webview"] as int;
-          final id = call.arguments["id"] as int;
-          final error = call.arguments["error"] as int;
-          final msg = call.arguments["message"] as String?;
-          final data = call.arguments["data"] as String?;
-
-          _jsCallResponseStream.add(_WebViewEvent(
+    // Background isolate messengers don't support incoming messages.
+    if (_background) {
+      return;
+    }
+
+    binaryChannel.setMessageHandler((message) async {
+      if (message != null && message.lengthInBytes > 0) {
+        _handleBinaryEvent(BinaryReader(message));
+      }
+      return null;
+    });
+    methodChannel.setMethodCallHandler(_handleMethodCall);
+  }
+
+  Future<dynamic> _handleMethodCall(MethodCall call) async {
+    switch (call.method) {
+      case "on_uri_changed":
+        final webview = call.arguments["webview"] as int;
+        final uri = call.arguments["uri"] as String?;
+        _uriEventStream.add(_WebViewEvent(webview, uri));
+        break;
+      case "on_title_changed":
+        final webview = call.arguments["webview"] as int;
+        final title = call.arguments["title"] as String?;
+        _titleEventStream.add(_WebViewEvent(webview, title));
+        break;
+      case "on_javascript_callback":
+        final webview = call.arguments["webview"] as int;
+        final name = call.arguments["name"] as String;
+        final data = call.arguments["data"] as String?;
+        _javascriptCallbackStream.add(_WebViewEvent(
+          webview,
+          _JSCallback(
+              name, data == null || data.isEmpty ? null : jsonDecode(data)),
+        ));
+        break;
+      case "on_decide_policy":
+        final webview = call.arguments["webview"] as int;
+        final uri = call.arguments["uri"] as String;
+        final newWindow = call.arguments["new_window"] as bool;
+        final fallback = _navigationFallbacks[webview];
+        if (fallback == null) {
+          return NavigationAction.allow.index;
+        }
+        return (await fallback(uri, newWindow)).index;
+      case "on_download_started":
+        final webview = call.arguments["webview"] as int;
+        _downloadEventStream.add(_WebViewEvent(
+            webview,
+            DownloadEvent(
+                call.arguments["download"] as int, DownloadState.started,
+                uri: call.arguments["uri"] as String,
+                destination: call.arguments["destination"] as String,
+                total: call.arguments["total"] as int)));
+        break;
+      case "on_download_progress":
+        final webview = call.arguments["webview"] as int;
+        _downloadEventStream.add(_WebViewEvent(
             webview,
-            _JSCallResponse(id, error, msg,
-                data == null || data.isEmpty ? null : jsonDecode(data)),
-          ));
-          break;
-        case "on_uri_changed":
-          final webview = call.arguments["webview"] as int;
-          final uri = call.arguments["uri"] as String?;
-          _uriEventStream.add(_WebViewEvent(webview, uri));
-          break;
-        case "on_title_changed":
-          final webview = call.arguments["webview"] as int;
-          final title = call.arguments["title"] as String?;
-          _titleEventStream.add(_WebViewEvent(webview, title));
-          break;
-        case "on_javascript_callback":
-          final webview = call.arguments["webview"] as int;
-          final name = call.arguments["name"] as String;
-          final data = call.arguments["data"] as String?;
-          _javascriptCallbackStream.add(_WebViewEvent(
+            DownloadEvent(
+                call.arguments["download"] as int, DownloadState.progress,
+                received: call.arguments["received"] as int,
+                total: call.arguments["total"] as int)));
+        break;
+      case "on_download_finished":
+        final webview = call.arguments["webview"] as int;
+        final size = call.arguments["size"] as int;
+        _downloadEventStream.add(_WebViewEvent(
             webview,
-            _JSCallback(
-                name, data == null || data.isEmpty ? null : jsonDecode(data)),
-          ));
-          break;
+            DownloadEvent(
+                call.arguments["download"] as int, DownloadState.finished,
+                destination: call.arguments["destination"] as String,
+                received: size,
+                total: size)));
+        break;
+      case "on_download_failed":
+        final webview = call.arguments["webview"] as int;
+        final cancelled = call.arguments["cancelled"] as bool;
+        _downloadEventStream.add(_WebViewEvent(
+            webview,
+            DownloadEvent(call.arguments["download"] as int,
+                cancelled ? DownloadState.cancelled : DownloadState.failed,
+                error: call.arguments["message"] as String?)));
+        break;
+      case "on_upload_started":
+        final webview = call.arguments["webview"] as int;
+        final upload = call.arguments["upload"] as int;
+        final name = call.arguments["name"] as String;
+        final contentType = call.arguments["content_type"] as String?;
+        final createSink = _uploadSinkFactories[webview]?[name];
+        if (createSink == null) {
+          return false;
+        }
+        _uploads[upload] = createSink(contentType);
+        return true;
+      case "on_upload_chunk":
+        final upload = call.arguments["upload"] as int;
+        final data = call.arguments["data"] as Uint8List;
+        // Replying acknowledges the chunk, the next one is read only then.
+        await _uploads[upload]?.add(data);
+        return true;
+      case "on_upload_finished":
+        final webview = call.arguments["webview"] as int;
+        final upload = call.arguments["upload"] as int;
+        final name = call.arguments["name"] as String;
+        final size = call.arguments["size"] as int;
+        final sink = _uploads.remove(upload);
+        if (sink != null) {
+          return await sink.close(size);
+        }
+        _uploadFileCallbacks[webview]?[name]?.call(size);
+        break;
+      case "on_upload_failed":
+        final upload = call.arguments["upload"] as int;
+        final message = call.arguments["message"] as String;
+        _uploads.remove(upload)?.addError(message);
+        break;
+    }
+
+    return null;
+  }
+
+  /// Delivers the queued events of [webviewId] until the view is destroyed.
+  Future<void> _pollEvents(int webviewId) async {
+    while (true) {
+      final List? events;
+      try {
+        events = await methodChannel
+            .invokeListMethod("poll_events", {"webview": webviewId});
+      } on PlatformException {
+        return;
+      }
+      if (events == null) {
+        return;
       }
 
-      return null;
-    });
+      for (final event in events) {
+        final binary = event["binary"] as Uint8List?;
+        if (binary != null) {
+          _handleBinaryEvent(BinaryReader(ByteData.sublistView(binary)));
+          continue;
+        }
+
+        final result = _handleMethodCall(
+            MethodCall(event["method"] as String, event["args"]));
+        final request = event["request"] as int?;
+        if (request != null) {
+          // Not awaited, a slow reply must not hold up later events.
+          result.then(
+              (value) => methodChannel.invokeMethod<void>("reply_event",
+                  {"webview": webviewId, "request": request, "result": value}),
+              onError: (Object error) => methodChannel.invokeMethod<void>(
+                  "reply_event", {
+                    "webview": webviewId,
+                    "request": request,
+                    "error": error.toString()
+                  }));
+        }
+      }
+    }
   }
 
   @override
@@ -102,12 +237,70 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
   }
 
   @override
-  Future<int?> createWebView(Map<dynamic, dynamic> args) {
-    return methodChannel.invokeMethod<int>('create_webview', args);
+  Future<int?> createWebView(Map<dynamic, dynamic> args) async {
+    if (!_background) {
+      return methodChannel.invokeMethod<int>('create_webview', args);
+    }
+
+    final id = await methodChannel
+        .invokeMethod<int>('create_webview', {...args, "background": true});
+    if (id != null) {
+      _pollEvents(id);
+    }
+    return id;
+  }
+
+  @override
+  Future<int> getHost() async {
+    final v = await methodChannel.invokeMethod<int>('get_host');
+    return v!;
+  }
+
+  @override
+  Future<bool> moveWebView(int webviewId, int host) async {
+    final v = await methodChannel
+        .invokeMethod<bool>('move_webview', {"webview": webviewId, "host": host});
+    return v ?? false;
+  }
+
+  @override
+  Future<bool> startTracing(String path) async {
+    final v =
+        await methodChannel.invokeMethod<bool>('start_tracing', {"path": path});
+    return v ?? false;
+  }
+
+  @override
+  Future<String?> stopTracing() {
+    return methodChannel.invokeMethod<String>('stop_tracing');
+  }
+
+  @override
+  Future<List<LogRecord>> getLogs() async {
+    final v = await methodChannel.invokeListMethod<Map>('get_logs');
+    return (v ?? [])
+        .map((e) => LogRecord(
+              DateTime.fromMicrosecondsSinceEpoch(e["time"] as int),
+              LogLevel.values[e["level"] as int],
+              LogCategory.values[e["category"] as int],
+              e["message"] as String,
+            ))
+        .toList();
+  }
+
+  @override
+  Future<void> setLogLevel(LogCategory? category, LogLevel level) {
+    return methodChannel.invokeMethod<void>('set_log_level', {
+      "category": category?.index,
+      "level": level.index,
+    });
   }
 
   @override
   Future<void> destroyWebView(int webviewId) {
+    _navigationFallbacks.remove(webviewId);
+    _uploadSinkFactories.remove(webviewId);
+    _uploadFileCallbacks.remove(webviewId);
     return methodChannel
         .invokeMethod<void>('destroy_webview', {"webview": webviewId});
   }
@@ -118,15 +311,39 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
         .invokeMethod<void>('open', {"webview": webviewId, "uri": uri});
   }
 
+  void _handleBinaryEvent(BinaryReader reader) {
+    switch (reader.u8()) {
+      case eventLoadProgress:
+        final webview = reader.u64();
+        _progressEventStream.add(_WebViewEvent(webview, reader.f64()));
+        break;
+      case eventLoadChanged:
+        final webview = reader.u64();
+        final e = reader.u8();
+
+        _loadEventStream
+            .add(_WebViewEvent<LoadEvent>(webview, LoadEvent.values[e]));
+        break;
+    }
+  }
+
   @override
-  Future<void> setDimension(int webviewId, Rect rect) {
-    return methodChannel.invokeMethod<void>('set_dimension', {
-      "webview": webviewId,
-      "x": rect.topLeft.dx.toInt(),
-      "y": rect.topLeft.dy.toInt(),
-      "w": rect.width.toInt(),
-      "h": rect.height.toInt()
-    });
+  Future<void> setDimension(int webviewId, Rect rect, [Rect? clip]) async {
+    final w = BinaryWriter(opSetDimension)
+      ..u64(webviewId)
+      ..i32(rect.left.toInt())
+      ..i32(rect.top.toInt())
+      ..i32(rect.width.toInt())
+      ..i32(rect.height.toInt())
+      ..u8(clip != null ? 1 : 0);
+    if (clip != null) {
+      w
+        ..i32(clip.left.toInt())
+        ..i32(clip.top.toInt())
+        ..i32(clip.width.toInt())
+        ..i32(clip.height.toInt());
+    }
+    await binaryChannel.send(w.finish());
   }
 
   @override
@@ -150,25 +367,53 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
         .map((event) => event.data);
   }
 
+  @override
+  Stream<double> getProgressEvents(int webviewId) {
+    return _progressEventStream.stream
+        .where((event) => event.webviewId == webviewId)
+        .map((event) => event.data);
+  }
+
+  @override
+  Stream<DownloadEvent> getDownloadEvents(int webviewId) {
+    return _downloadEventStream.stream
+        .where((event) => event.webviewId == webviewId)
+        .map((event) => event.data);
+  }
+
   @override
   Future<dynamic> evaluateJavascript(
       int webviewId, int callId, String script) async {
-    final completion = _jsCallResponseStream.stream.firstWhere((element) =>
-        element.webviewId == webviewId && element.data.callId == callId);
-
-    await methodChannel.invokeMethod<void>("evaluate_javascript", {
-      "webview": webviewId,
-      "id": callId,
-      "script": script,
-    });
+    // The result is the reply, so it is decoded in the calling isolate.
+    final reply = await binaryChannel.send((BinaryWriter(opEvaluateJavascript)
+          ..u64(webviewId)
+          ..u64(callId)
+          ..bytes(utf8.encode(script)))
+        .finish());
+    if (reply == null || reply.lengthInBytes == 0) {
+      throw WebViewError("Failed to evaluate javascript, no such webview.");
+    }
 
-    final result = await completion;
-    if (result.data.error != 0) {
+    final result = _decodeJavascriptResult(BinaryReader(reply));
+    if (result.error != 0) {
       throw WebViewError(
-          "Failed to evaluate javascript (error ${result.data.error}): ${result.data.message}");
+          "Failed to evaluate javascript (error ${result.error}): ${result.message}");
     }
 
-    return result.data.data;
+    return result.data;
+  }
+
+  _JSCallResponse _decodeJavascriptResult(BinaryReader reader) {
+    reader.u8(); // eventJavascriptResult
+    reader.u64(); // webview
+    final id = reader.u64();
+    final error = reader.i32();
+    final msgLength = reader.u32();
+    final msg = msgLength == 0 ? null : reader.string(msgLength);
+    final data = reader.rest();
+
+    return _JSCallResponse(
+        id, error, msg, data.isEmpty ? null : jsonDecode(data));
   }
 
   @override
@@ -179,6 +424,45 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
     });
   }
 
+  @override
+  Future<bool> goBack(int webviewId) async {
+    final v = await methodChannel
+        .invokeMethod<bool>("go_back", {"webview": webviewId});
+    return v ?? false;
+  }
+
+  @override
+  Future<bool> goForward(int webviewId) async {
+    final v = await methodChannel
+        .invokeMethod<bool>("go_forward", {"webview": webviewId});
+    return v ?? false;
+  }
+
+  @override
+  Future<bool> goToIndex(int webviewId, int index) async {
+    final v = await methodChannel.invokeMethod<bool>("go_to_index", {
+      "webview": webviewId,
+      "index": index,
+    });
+    return v ?? false;
+  }
+
+  @override
+  Future<BackForwardList> getBackForwardList(int webviewId) async {
+    final v = await methodChannel
+        .invokeMapMethod<String, dynamic>("get_back_forward_list", {
+      "webview": webviewId,
+    });
+    if (v == null) {
+      return BackForwardList([], -1);
+    }
+
+    final items = (v["items"] as List)
+        .map((e) => HistoryItem(e["uri"] as String, e["title"] as String?))
+        .toList();
+    return BackForwardList(items, v["current"] as int);
+  }
+
   @override
   Future<bool> registerJavascriptCallback(int webviewId, String name) async {
     final v =
@@ -205,9 +489,191 @@ class MethodChannelFlutterWebkit extends FlutterWebkitPlatform {
         .map((event) => event.data.data);
   }
 
+  @override
+  Future<bool> updateSettings(
+      int webviewId, String? preset, Map<String, Object?>? settings) async {
+    final args = <String, dynamic>{"webview": webviewId};
+    if (preset != null) {
+      args["preset"] = preset;
+    }
+    if (settings != null) {
+      args["settings"] = settings;
+    }
+
+    final v = await methodChannel.invokeMethod<bool>("update_settings", args);
+    return v ?? false;
+  }
+
+  @override
+  Future<void> setHeadlessLimit(int limit) {
+    return methodChannel
+        .invokeMethod<void>("set_headless_limit", {"limit": limit});
+  }
+
+  @override
+  Future<void> setAdaptiveQuality(bool enabled) {
+    return methodChannel
+        .invokeMethod<void>("set_adaptive_quality", {"enabled": enabled});
+  }
+
+  @override
+  Future<QualityTier> getQualityTier(int webviewId) async {
+    final v = await methodChannel
+        .invokeMethod<int>("get_quality_tier", {"webview": webviewId});
+    return QualityTier.values[v ?? 0];
+  }
+
+  @override
+  Future<bool> prerender(int webviewId, String uri) async {
+    final v = await methodChannel
+        .invokeMethod<bool>("prerender", {"webview": webviewId, "uri": uri});
+    return v ?? false;
+  }
+
+  @override
+  Future<void> cancelPrerender(int webviewId, String? uri) {
+    return methodChannel.invokeMethod<void>(
+        "cancel_prerender", {"webview": webviewId, "uri": uri});
+  }
+
+  @override
+  Future<void> setPrerenderLimit(int limit) {
+    return methodChannel
+        .invokeMethod<void>("set_prerender_limit", {"limit": limit});
+  }
+
+  @override
+  Future<void> registerUploadHandler(int webviewId, String name,
+      UploadSink Function(String? contentType) createSink) {
+    _uploadSinkFactories.putIfAbsent(webviewId, () => {})[name] = createSink;
+    _uploadFileCallbacks[webviewId]?.remove(name);
+    return methodChannel.invokeMethod<void>(
+        "register_upload_handler", {"webview": webviewId, "name": name});
+  }
+
+  @override
+  Future<void> registerUploadFile(int webviewId, String name, String path,
+      void Function(int size)? onSaved) {
+    _uploadFileCallbacks.putIfAbsent(webviewId, () => {})[name] = onSaved;
+    _uploadSinkFactories[webviewId]?.remove(name);
+    return methodChannel.invokeMethod<void>("register_upload_handler",
+        {"webview": webviewId, "name": name, "path": path});
+  }
+
+  @override
+  Future<void> unregisterUploadHandler(int webviewId, String name) {
+    _uploadSinkFactories[webviewId]?.remove(name);
+    _uploadFileCallbacks[webviewId]?.remove(name);
+    return methodChannel.invokeMethod<void>(
+        "unregister_upload_handler", {"webview": webviewId, "name": name});
+  }
+
+  @override
+  Future<int> warmUp(List<String> uris) async {
+    final v = await methodChannel.invokeMethod<int>("warm_up", {"uris": uris});
+    return v ?? 0;
+  }
+
+  @override
+  Future<WarmUpStats> getWarmUpStats() async {
+    final v = await methodChannel
+        .invokeMapMethod<String, dynamic>("get_warm_up_stats");
+    return WarmUpStats(v!["warmed"] as int, v["used"] as int,
+        v["deduplicated"] as int, v["rate_limited"] as int,
+        v["preconnected"] as int);
+  }
+
+  @override
+  Future<void> setDownloadRules(
+      List<Map<dynamic, dynamic>> rules,
+      String? defaultDirectory,
+      bool cancelUnmatched,
+      Duration progressInterval) {
+    return methodChannel.invokeMethod<void>("set_download_rules", {
+      "rules": rules,
+      "default_directory": defaultDirectory,
+      "cancel_unmatched": cancelUnmatched,
+      "progress_interval": progressInterval.inMilliseconds,
+    });
+  }
+
+  @override
+  Future<bool> cancelDownload(int id) async {
+    final v = await methodChannel
+        .invokeMethod<bool>("cancel_download", {"download": id});
+    return v ?? false;
+  }
+
+  @override
+  Future<Uint8List> snapshot(int webviewId, bool fullDocument) async {
+    final v = await methodChannel.invokeMethod<Uint8List>("snapshot", {
+      "webview": webviewId,
+      "full_document": fullDocument,
+    });
+    if (v == null) {
+      throw WebViewError("Failed to take snapshot of webview #$webviewId.");
+    }
+    return v;
+  }
+
+  @override
+  Future<ResourceTimeline?> getResourceTimeline(int webviewId) async {
+    final r = await methodChannel.invokeMethod<Map<dynamic, dynamic>>(
+        "get_resource_timeline", {"webview": webviewId});
+    if (r == null) {
+      return null;
+    }
+
+    Duration? offset(int us) => us < 0 ? null : Duration(microseconds: us);
+
+    final uri = r["uri"] as List<dynamic>;
+    final mime = r["mime"] as List<dynamic>;
+    final error = r["error"] as List<dynamic>;
+    final status = r["status"] as Int32List;
+    final size = r["size"] as Int64List;
+    final start = r["start"] as Int64List;
+    final response = r["response"] as Int64List;
+    final finish = r["finish"] as Int64List;
+
+    return ResourceTimeline(
+      List.generate(
+          uri.length,
+          (i) => ResourceTiming(
+              uri[i] as String,
+              mime[i] as String?,
+              status[i],
+              size[i],
+              Duration(microseconds: start[i]),
+              offset(response[i]),
+              offset(finish[i]),
+              error[i] as String?)),
+      r["dropped"] as int,
+    );
+  }
+
   @override
   Future<void> openInspector(int webviewId) {
     return methodChannel
         .invokeMethod<void>("open_inspector", {"webview": webviewId});
   }
+
+  @override
+  Future<void> setNavigationRules(
+      int webviewId,
+      List<Map<dynamic, dynamic>> rules,
+      NavigationAction defaultAction,
+      Future<NavigationAction> Function(String uri, bool newWindow)? fallback) {
+    if (fallback == null) {
+      _navigationFallbacks.remove(webviewId);
+    } else {
+      _navigationFallbacks[webviewId] = fallback;
+    }
+
+    return methodChannel.invokeMethod<void>("set_navigation_rules", {
+      "webview": webviewId,
+      "rules": rules,
+      "default_action": defaultAction.index,
+      "fallback": fallback != null,
+    });
+  }
 }
@@ -1,3 +1,4 @@
+import 'dart:typed_data';
 import 'dart:ui';
 
 import 'package:flutter_webkit/src/types.dart';
@@ -38,6 +39,14 @@ abstract class FlutterWebkitPlatform extends PlatformInterface {
     throw UnimplementedError('getTitleEvents() has not been implemented.');
   }
 
+  Stream<double> getProgressEvents(int webviewId) {
+    throw UnimplementedError('getProgressEvents() has not been implemented.');
+  }
+
+  Stream<DownloadEvent> getDownloadEvents(int webviewId) {
+    throw UnimplementedError('getDownloadEvents() has not been implemented.');
+  }
+
   Stream<dynamic> getJavascriptCallbackStream(int webviewId, String name){
     throw UnimplementedError('getJavascriptCallbackStream() has not been implemented.');
   }
@@ -50,6 +59,30 @@ abstract class FlutterWebkitPlatform extends PlatformInterface {
     throw UnimplementedError('createWebView() has not been implemented.');
   }
 
+  Future<int> getHost() {
+    throw UnimplementedError('getHost() has not been implemented.');
+  }
+
+  Future<bool> moveWebView(int webviewId, int host) {
+    throw UnimplementedError('moveWebView() has not been implemented.');
+  }
+
+  Future<bool> startTracing(String path) {
+    throw UnimplementedError('startTracing() has not been implemented.');
+  }
+
+  Future<String?> stopTracing() {
+    throw UnimplementedError('stopTracing() has not been implemented.');
+  }
+
+  Future<List<LogRecord>> getLogs() {
+    throw UnimplementedError('getLogs() has not been implemented.');
+  }
+
+  Future<void> setLogLevel(LogCategory? category, LogLevel level) {
+    throw UnimplementedError('setLogLevel() has not been implemented.');
+  }
+
   Future<void> destroyWebView(int webviewId) {
     throw UnimplementedError('destroyWebView() has not been implemented.');
   }
@@ -58,7 +91,9 @@ abstract class FlutterWebkitPlatform extends PlatformInterface {
     throw UnimplementedError('open() has not been implemented.');
   }
 
-  Future<void> setDimension(int webviewId, Rect rect) {
+  /// [clip] is the visible part of the webview relative to [rect], or null if
+  /// the webview is fully visible.
+  Future<void> setDimension(int webviewId, Rect rect, [Rect? clip]) {
     throw UnimplementedError('setDimension() has not been implemented.');
   }
 
@@ -70,6 +105,22 @@ abstract class FlutterWebkitPlatform extends PlatformInterface {
     throw UnimplementedError('reload() has not been implemented.');
   }
 
+  Future<bool> goBack(int webviewId) {
+    throw UnimplementedError('goBack() has not been implemented.');
+  }
+
+  Future<bool> goForward(int webviewId) {
+    throw UnimplementedError('goForward() has not been implemented.');
+  }
+
+  Future<bool> goToIndex(int webviewId, int index) {
+    throw UnimplementedError('goToIndex() has not been implemented.');
+  }
+
+  Future<BackForwardList> getBackForwardList(int webviewId) {
+    throw UnimplementedError('getBackForwardList() has not been implemented.');
+  }
+
   Future<bool> registerJavascriptCallback(int webviewId, String name) {
     throw UnimplementedError('register_javascript_callback() has not been implemented.');
   }
@@ -78,7 +129,89 @@ abstract class FlutterWebkitPlatform extends PlatformInterface {
     throw UnimplementedError('unregister_javascript_callback() has not been implemented.');
   }
 
+  Future<bool> updateSettings(
+      int webviewId, String? preset, Map<String, Object?>? settings) {
+    throw UnimplementedError('updateSettings() has not been implemented.');
+  }
+
+  Future<void> setHeadlessLimit(int limit) {
+    throw UnimplementedError('setHeadlessLimit() has not been implemented.');
+  }
+
+  Future<void> setAdaptiveQuality(bool enabled) {
+    throw UnimplementedError('setAdaptiveQuality() has not been implemented.');
+  }
+
+  Future<QualityTier> getQualityTier(int webviewId) {
+    throw UnimplementedError('getQualityTier() has not been implemented.');
+  }
+
+  Future<bool> prerender(int webviewId, String uri) {
+    throw UnimplementedError('prerender() has not been implemented.');
+  }
+
+  Future<void> cancelPrerender(int webviewId, String? uri) {
+    throw UnimplementedError('cancelPrerender() has not been implemented.');
+  }
+
+  Future<void> setPrerenderLimit(int limit) {
+    throw UnimplementedError('setPrerenderLimit() has not been implemented.');
+  }
+
+  Future<void> registerUploadHandler(int webviewId, String name,
+      UploadSink Function(String? contentType) createSink) {
+    throw UnimplementedError(
+        'registerUploadHandler() has not been implemented.');
+  }
+
+  Future<void> registerUploadFile(int webviewId, String name, String path,
+      void Function(int size)? onSaved) {
+    throw UnimplementedError('registerUploadFile() has not been implemented.');
+  }
+
+  Future<void> unregisterUploadHandler(int webviewId, String name) {
+    throw UnimplementedError(
+        'unregisterUploadHandler() has not been implemented.');
+  }
+
+  Future<int> warmUp(List<String> uris) {
+    throw UnimplementedError('warmUp() has not been implemented.');
+  }
+
+  Future<WarmUpStats> getWarmUpStats() {
+    throw UnimplementedError('getWarmUpStats() has not been implemented.');
+  }
+
+  Future<void> setDownloadRules(
+      List<Map<dynamic, dynamic>> rules,
+      String? defaultDirectory,
+      bool cancelUnmatched,
+      Duration progressInterval) {
+    throw UnimplementedError('setDownloadRules() has not been implemented.');
+  }
+
+  Future<bool> cancelDownload(int id) {
+    throw UnimplementedError('cancelDownload() has not been implemented.');
+  }
+
+  Future<Uint8List> snapshot(int webviewId, bool fullDocument) {
+    throw UnimplementedError('snapshot() has not been implemented.');
+  }
+
+  Future<ResourceTimeline?> getResourceTimeline(int webviewId) {
+    throw UnimplementedError(
+        'getResourceTimeline() has not been implemented.');
+  }
+
   Future<void> openInspector(int webviewId) {
     throw UnimplementedError('openInspector() has not been implemented.');
   }
+
+  Future<void> setNavigationRules(
+      int webviewId,
+      List<Map<dynamic, dynamic>> rules,
+      NavigationAction defaultAction,
+      Future<NavigationAction> Function(String uri, bool newWindow)? fallback) {
+    throw UnimplementedError('setNavigationRules() has not been implemented.');
+  }
 }
@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 enum LoadEvent {
   started,
   redirected,
@@ -5,6 +7,63 @@ enum LoadEvent {
   finished;
 }
 
+/// What to do with a navigation matched by a [NavigationRule].
+enum NavigationAction {
+  allow,
+  block,
+  external;
+}
+
+/// A resource loaded during a navigation, see
+/// [WebViewController.getResourceTimeline].
+class ResourceTiming {
+  final String uri;
+  final String? mimeType;
+  final int statusCode;
+
+  /// Number of bytes received.
+  final int size;
+
+  /// Offsets from the start of the navigation.
+  final Duration start;
+  final Duration? response;
+  final Duration? finish;
+
+  /// Failure reason, or null if the resource didn't fail.
+  final String? error;
+
+  ResourceTiming(this.uri, this.mimeType, this.statusCode, this.size,
+      this.start, this.response, this.finish, this.error);
+}
+
+class ResourceTimeline {
+  final List<ResourceTiming> resources;
+
+  /// Number of resources not recorded because the native buffer was full.
+  final int dropped;
+
+  ResourceTimeline(this.resources, this.dropped);
+}
+
+/// Bundles of tuned WebKit settings.
+enum SettingsPreset {
+  /// No page cache, GPU, WebGL, media features or smooth scrolling.
+  lowMemory("low-memory"),
+
+  /// Pages loaded and rendered back to back without user interaction.
+  throughput("throughput"),
+
+  /// Lowest latency for a user interacting with the page.
+  ///
+  /// Neither this nor [throughput] changes the hardware acceleration policy,
+  /// set `"hardware-acceleration-policy": "always"` in
+  /// `WebViewSettings.webkitSettings` to force it.
+  interactive("interactive");
+
+  final String value;
+  const SettingsPreset(this.value);
+}
+
 class WebViewError extends Error {
   final Object? message;
 
@@ -19,3 +78,155 @@ class WebViewError extends Error {
     return "WebViewError";
   }
 }
+
+/// Receives the body of a page upload, see
+/// [WebViewController.registerUploadHandler].
+abstract class UploadSink {
+  /// Called for every chunk of the body. The next chunk is only read from
+  /// the page once the returned future completes.
+  Future<void> add(Uint8List chunk);
+
+  /// Called once all [size] bytes are received. A returned JSON string is
+  /// sent to the page as the response body.
+  Future<String?> close(int size);
+
+  /// Called instead of [close] if the upload fails.
+  void addError(String message) {}
+}
+
+/// Counters of [WebViewController.warmUp].
+class WarmUpStats {
+  /// Origins whose DNS was prefetched.
+  final int warmed;
+
+  /// Warmed origins that also had connections opened.
+  final int preconnected;
+
+  /// Warmed origins navigated to while still warm.
+  final int used;
+
+  /// Origins skipped because they were warmed recently.
+  final int deduplicated;
+
+  /// Origins skipped because too many were warmed at once.
+  final int rateLimited;
+
+  WarmUpStats(this.warmed, this.used, this.deduplicated, this.rateLimited,
+      [this.preconnected = 0]);
+
+  /// Warmed origins that only had their DNS prefetched so far.
+  int get dnsOnly => warmed - preconnected;
+
+  double get hitRate => warmed == 0 ? 0.0 : used / warmed;
+}
+
+enum DownloadState {
+  started,
+  progress,
+  finished,
+  failed,
+  cancelled;
+}
+
+/// A change of a download started by a webview, see
+/// [WebViewController.downloadStream].
+class DownloadEvent {
+  /// Identifies the download, see [WebViewController.cancelDownload].
+  final int id;
+  final DownloadState state;
+
+  /// Only set for [DownloadState.started].
+  final String? uri;
+
+  /// File the download is written to, set for [DownloadState.started] and
+  /// [DownloadState.finished].
+  final String? destination;
+
+  /// Bytes written so far.
+  final int received;
+
+  /// Expected size in bytes, or 0 if the server didn't tell.
+  final int total;
+
+  /// Failure reason of [DownloadState.failed].
+  final String? error;
+
+  DownloadEvent(this.id, this.state,
+      {this.uri,
+      this.destination,
+      this.received = 0,
+      this.total = 0,
+      this.error});
+}
+
+/// An entry of a webview's session history.
+class HistoryItem {
+  final String uri;
+  final String? title;
+
+  HistoryItem(this.uri, this.title);
+}
+
+/// Session history of a webview, see [WebViewController.getBackForwardList].
+class BackForwardList {
+  /// Oldest first.
+  final List<HistoryItem> items;
+
+  /// Index of the current page in [items], -1 before the first load.
+  final int currentIndex;
+
+  BackForwardList(this.items, this.currentIndex);
+
+  bool get canGoBack => currentIndex > 0;
+  bool get canGoForward =>
+      currentIndex >= 0 && currentIndex < items.length - 1;
+}
+
+/// Render quality of a webview while its window can't keep up, see
+/// [WebViewController.setAdaptiveQuality]. Each tier includes the ones
+/// before it. Values match linux/WebView.h.
+enum QualityTier {
+  full,
+  noSmoothScrolling,
+
+  /// Animation frames are capped to 30 per second.
+  halfFrameRate,
+
+  /// Animation frames are capped to 15 per second.
+  quarterFrameRate;
+}
+
+/// Values match linux/Log.h.
+enum LogLevel {
+  debug,
+  info,
+  warning,
+  error,
+  none;
+}
+
+/// Values match linux/Log.h.
+enum LogCategory {
+  plugin,
+  manager,
+  webview,
+  navigation,
+  settings,
+  download,
+  upload,
+  tracing;
+}
+
+/// A record of the native log buffer, see [WebViewController.getLogs].
+class LogRecord {
+  final DateTime time;
+  final LogLevel level;
+  final LogCategory category;
+  final String message;
+
+  LogRecord(this.time, this.level, this.category, this.message);
+
+  @override
+  String toString() =>
+      "${time.toIso8601String()} ${level.name} ${category.name}: $message";
+}
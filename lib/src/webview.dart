@@ -1,31 +1,83 @@
 import 'dart:async';
+import 'dart:typed_data';
 
 import 'package:flutter/widgets.dart';
 import 'package:flutter_webkit/src/flutter_webkit.dart';
 import 'package:flutter_webkit/src/types.dart';
 
-class WebView extends StatelessWidget {
+class WebView extends StatefulWidget {
   final WebViewController controller;
   const WebView({super.key, required this.controller});
 
+  @override
+  State<WebView> createState() => _WebViewState();
+}
+
+class _WebViewState extends State<WebView> {
+  Rect? _rect;
+  Rect? _clip;
+
+  @override
+  void initState() {
+    super.initState();
+    _scheduleUpdate();
+  }
+
+  // Checked after every frame, scrolling or clipping ancestors move the view
+  // without rebuilding it. Only changes are sent to the native side.
+  void _scheduleUpdate() {
+    WidgetsBinding.instance.addPostFrameCallback((timeStamp) {
+      if (!mounted) {
+        return;
+      }
+      _update();
+      _scheduleUpdate();
+    });
+  }
+
+  void _update() {
+    final renderObject = context.findRenderObject();
+    if (renderObject == null || !renderObject.attached) {
+      return;
+    }
+
+    final rect = MatrixUtils.transformRect(
+        renderObject.getTransformTo(null), renderObject.paintBounds);
+
+    // Intersect with the clip of every ancestor to find the visible part.
+    var visible = rect;
+    RenderObject child = renderObject;
+    var parent = child.parent as RenderObject?;
+    while (parent != null) {
+      final clip = parent.describeApproximatePaintClip(child);
+      if (clip != null) {
+        visible = visible.intersect(
+            MatrixUtils.transformRect(parent.getTransformTo(null), clip));
+      }
+      child = parent;
+      parent = child.parent as RenderObject?;
+    }
+
+    Rect? clip;
+    if (visible.width <= 0 || visible.height <= 0) {
+      clip = Rect.zero;
+    } else if (visible != rect) {
+      clip = visible.shift(-rect.topLeft);
+    }
+
+    if (rect == _rect && clip == _clip) {
+      return;
+    }
+    _rect = rect;
+    _clip = clip;
+    widget.controller._update(rect, clip);
+  }
+
   @override
   Widget build(BuildContext context) {
-    return LayoutBuilder(
-      builder: (context, constraints) {
-        WidgetsBinding.instance.addPostFrameCallback((timeStamp) async {
-          final renderObject = context.findRenderObject();
-          if (renderObject != null) {
-            final matrix = renderObject.getTransformTo(null);
-            final rect =
-                MatrixUtils.transformRect(matrix, renderObject.paintBounds);
-            controller._update(rect);
-          }
-        });
-        return Container(
-          constraints: const BoxConstraints.expand(),
-          color: const Color(0x00000000),
-        );
-      },
+    return Container(
+      constraints: const BoxConstraints.expand(),
+      color: const Color(0x00000000),
     );
   }
 }
@@ -35,10 +87,33 @@ class WebViewSettings {
   final bool? allowFileAccessFromFileUrls;
   final bool? enableDeveloperExtras;
 
+  /// Tuned defaults applied before any other setting.
+  final SettingsPreset? preset;
+
+  /// Any `WebKitSettings` property by name, e.g.
+  /// `{"enable-smooth-scrolling": false, "hardware-acceleration-policy": "never"}`.
+  /// Enum properties accept the value or its nick.
+  final Map<String, Object?>? webkitSettings;
+
+  /// Maximum number of resources recorded per navigation for
+  /// [WebViewController.getResourceTimeline], 0 disables recording.
+  final int? resourceTimelineCapacity;
+
+  /// Minimum change of load progress reported by [WebViewController.progressStream].
+  final double? progressMinDelta;
+
+  /// Minimum interval between two events of [WebViewController.progressStream].
+  final Duration? progressInterval;
+
   WebViewSettings(
       {this.corsAllowList,
       this.allowFileAccessFromFileUrls,
-      this.enableDeveloperExtras});
+      this.enableDeveloperExtras,
+      this.preset,
+      this.webkitSettings,
+      this.progressMinDelta,
+      this.progressInterval,
+      this.resourceTimelineCapacity});
 
   Map<dynamic, dynamic> _toMap() {
     final ret = <String, dynamic>{};
@@ -52,6 +127,107 @@ class WebViewSettings {
     if (enableDeveloperExtras != null) {
       ret["enable_developer_extras"] = enableDeveloperExtras;
     }
+    if (preset != null) {
+      ret["preset"] = preset!.value;
+    }
+    if (webkitSettings != null) {
+      ret["settings"] = webkitSettings;
+    }
+    if (progressMinDelta != null) {
+      ret["progress_min_delta"] = progressMinDelta;
+    }
+    if (progressInterval != null) {
+      ret["progress_interval"] = progressInterval!.inMilliseconds;
+    }
+    if (resourceTimelineCapacity != null) {
+      ret["resource_timeline_capacity"] = resourceTimelineCapacity;
+    }
+
+    return ret;
+  }
+}
+
+/// A navigation rule evaluated natively on every navigation.
+///
+/// URIs are matched against their canonical form `scheme://host/path`, with
+/// lower case scheme and host and without port, query or fragment. A rule
+/// matches by [prefix], by [regex], or by any combination of [scheme], [host]
+/// (which may start with `*.` to include subdomains) and [path] prefix.
+/// Rules are evaluated in order and the first matching rule wins.
+class NavigationRule {
+  final NavigationAction action;
+  final String? prefix;
+  final String? regex;
+  final String? scheme;
+  final String? host;
+  final String? path;
+
+  const NavigationRule(
+      {required this.action,
+      this.prefix,
+      this.regex,
+      this.scheme,
+      this.host,
+      this.path});
+
+  Map<dynamic, dynamic> _toMap() {
+    final ret = <String, dynamic>{"action": action.index};
+
+    if (prefix != null) {
+      ret["prefix"] = prefix;
+    }
+    if (regex != null) {
+      ret["regex"] = regex;
+    }
+    if (scheme != null) {
+      ret["scheme"] = scheme;
+    }
+    if (host != null) {
+      ret["host"] = host;
+    }
+    if (path != null) {
+      ret["path"] = path;
+    }
+
+    return ret;
+  }
+}
+
+/// Decides where a download goes, see [WebViewController.setDownloadRules].
+///
+/// [filename], [host] and [mimeType] are glob patterns (`*` and `?`), a rule
+/// matches if all given patterns match. Matching downloads are saved into
+/// [directory], or cancelled if [cancel] is true.
+class DownloadRule {
+  final String? filename;
+  final String? host;
+  final String? mimeType;
+  final String? directory;
+  final bool cancel;
+
+  const DownloadRule(
+      {this.filename,
+      this.host,
+      this.mimeType,
+      this.directory,
+      this.cancel = false})
+      : assert(cancel || directory != null);
+
+  Map<dynamic, dynamic> _toMap() {
+    final ret = <String, dynamic>{"cancel": cancel};
+
+    if (filename != null) {
+      ret["filename"] = filename;
+    }
+    if (host != null) {
+      ret["host"] = host;
+    }
+    if (mimeType != null) {
+      ret["mime"] = mimeType;
+    }
+    if (directory != null) {
+      ret["directory"] = directory;
+    }
 
     return ret;
   }
@@ -66,25 +242,120 @@ class WebViewController {
   late final _loadEvents = StreamController<LoadEvent>.broadcast();
   late final _uriEvents = StreamController<String?>.broadcast();
   late final _titleEvents = StreamController<String?>.broadcast();
+  late final _progressEvents = StreamController<double>.broadcast();
+  late final _downloadEvents = StreamController<DownloadEvent>.broadcast();
 
   int _jsCallId = 0;
 
-  WebViewController({String? uri, WebViewSettings? settings}) {
+  /// Creates a webview in the window of [host], or in the window of the
+  /// calling engine if [host] is null. See [getHost].
+  WebViewController({String? uri, WebViewSettings? settings, int? host}) {
     settings ??= WebViewSettings();
-    _plugin.createWebView(settings._toMap()).then((value) {
+    final args = settings._toMap();
+    if (host != null) {
+      args["host"] = host;
+    }
+    _create(args, uri);
+  }
+
+  /// Creates a webview that is never attached to a window, for background
+  /// work such as rendering snapshots or running scripts. It renders into
+  /// an offscreen window of [viewport] logical pixels, gets no input and
+  /// doesn't use GPU compositing. The number of headless views running at
+  /// once is limited, see [setHeadlessLimit].
+  ///
+  /// Headless views can also be driven from a background isolate once it
+  /// called `BackgroundIsolateBinaryMessenger.ensureInitialized`. Their
+  /// events, script results, downloads and uploads are then delivered to
+  /// that isolate only.
+  WebViewController.headless(
+      {String? uri,
+      WebViewSettings? settings,
+      Size viewport = const Size(1280, 720)}) {
+    settings ??= WebViewSettings();
+    final args = settings._toMap();
+    args["headless"] = true;
+    args["viewport_width"] = viewport.width.toInt();
+    args["viewport_height"] = viewport.height.toInt();
+    _create(args, uri);
+  }
+
+  void _create(Map<dynamic, dynamic> args, String? uri) {
+    _plugin.createWebView(args).then((value) {
       _handle = value!;
 
       _loadEvents.addStream(_plugin.getLoadEvents(_handle));
       _uriEvents.addStream(_plugin.getUriEvents(_handle));
       _titleEvents.addStream(_plugin.getTitleEvents(_handle));
+      _progressEvents.addStream(_plugin.getProgressEvents(_handle));
+      _downloadEvents.addStream(_plugin.getDownloadEvents(_handle));
 
       _readyCompleter.complete();
       if (uri != null) {
         open(uri);
       }
+    }, onError: (e) {
+      _readyCompleter.completeError(WebViewError(e));
     });
   }
 
+  /// Limits the number of headless webviews alive at the same time.
+  static Future<void> setHeadlessLimit(int limit) {
+    return FlutterWebkit().setHeadlessLimit(limit);
+  }
+
+  /// Lets webviews trade render quality for frame rate when their window
+  /// can't keep up with the display. Views step down one [QualityTier] at a
+  /// time, unfocused views first, and step back up once frames keep up
+  /// again. Disabling restores full quality.
+  static Future<void> setAdaptiveQuality(bool enabled) {
+    return FlutterWebkit().setAdaptiveQuality(enabled);
+  }
+
+  /// The current [QualityTier] of this webview.
+  Future<QualityTier> getQualityTier() async {
+    await ready;
+    return _plugin.getQualityTier(_handle);
+  }
+
+  /// Limits the number of prerendered pages kept across all webviews. The
+  /// least recently requested prerender is evicted first, 0 disables
+  /// prerendering.
+  static Future<void> setPrerenderLimit(int limit) {
+    return FlutterWebkit().setPrerenderLimit(limit);
+  }
+
+  /// Prefetches DNS and opens connections for the origins of [uris], so the
+  /// next navigation to them doesn't start cold. Origins warmed recently are
+  /// skipped and warm-ups are rate limited. Returns the number of origins
+  /// warmed up.
+  static Future<int> warmUp(List<String> uris) {
+    return FlutterWebkit().warmUp(uris);
+  }
+
+  static Future<WarmUpStats> getWarmUpStats() {
+    return FlutterWebkit().getWarmUpStats();
+  }
+
+  /// Replaces the rules deciding where downloads of all webviews go. The
+  /// first matching rule applies. Other downloads are cancelled if
+  /// [cancelUnmatched], or saved into [defaultDirectory], which defaults
+  /// to the user's download directory.
+  static Future<void> setDownloadRules(List<DownloadRule> rules,
+      {String? defaultDirectory,
+      bool cancelUnmatched = false,
+      Duration progressInterval = const Duration(milliseconds: 250)}) {
+    return FlutterWebkit().setDownloadRules(
+        rules.map((e) => e._toMap()).toList(),
+        defaultDirectory,
+        cancelUnmatched,
+        progressInterval);
+  }
+
+  static Future<bool> cancelDownload(int id) {
+    return FlutterWebkit().cancelDownload(id);
+  }
+
   Future<void> get ready {
     return _readyCompleter.future;
   }
@@ -97,6 +368,20 @@ class WebViewController {
     return _titleEvents.stream;
   }
 
+  /// Estimated load progress between 0.0 and 1.0, throttled natively
+  /// according to [WebViewSettings.progressMinDelta] and
+  /// [WebViewSettings.progressInterval].
+  Stream<double> get progressStream {
+    return _progressEvents.stream;
+  }
+
+  /// Downloads started by this webview. Data is written to disk natively,
+  /// progress is reported at most once per progress interval, see
+  /// [setDownloadRules].
+  Stream<DownloadEvent> get downloadStream {
+    return _downloadEvents.stream;
+  }
+
   Stream<LoadEvent> get loadingStatusStream {
     return _loadEvents.stream;
   }
@@ -142,6 +427,58 @@ class WebViewController {
     _plugin.open(_handle, uri);
   }
 
+  /// Loads [uri] in a hidden view next to this one. A later [open] of the
+  /// same [uri] swaps the page in without loading it again, keeping this
+  /// controller and its javascript callbacks. Prerenders that navigate
+  /// somewhere the navigation rules don't allow, or fail to load, are
+  /// dropped and [open] loads normally.
+  ///
+  /// The swapped in page starts a new session history, pages visited before
+  /// it can't be reached with [goBack] anymore.
+  Future<bool> prerender(String uri) async {
+    await ready;
+    return _plugin.prerender(_handle, uri);
+  }
+
+  /// Drops the prerender of [uri], or all prerenders of this webview.
+  Future<void> cancelPrerender([String? uri]) async {
+    await ready;
+    return _plugin.cancelPrerender(_handle, uri);
+  }
+
+  /// Accepts uploads POSTed by the page to `flutter-webkit://upload/<name>`.
+  /// The body is read in chunks and handed to the sink created by
+  /// [createSink] for each upload, instead of going through a JSON
+  /// message.
+  ///
+  /// ```js
+  /// await fetch("flutter-webkit://upload/recording", {method: "POST", body: blob});
+  /// ```
+  ///
+  /// Only requests from the origin of the page currently loaded in this
+  /// webview are accepted, frames embedded from other origins are refused.
+  /// Pages without an http(s) origin, like local files, share the opaque
+  /// origin `null` with any sandboxed or `data:` frame they embed.
+  Future<void> registerUploadHandler(
+      String name, UploadSink Function(String? contentType) createSink) async {
+    await ready;
+    return _plugin.registerUploadHandler(_handle, name, createSink);
+  }
+
+  /// Like [registerUploadHandler], but uploads to [name] are written to
+  /// [path] natively, replacing any previous content. [onSaved] is called
+  /// with the size once the file is complete.
+  Future<void> registerUploadFile(String name, String path,
+      {void Function(int size)? onSaved}) async {
+    await ready;
+    return _plugin.registerUploadFile(_handle, name, path, onSaved);
+  }
+
+  Future<void> unregisterUploadHandler(String name) async {
+    await ready;
+    return _plugin.unregisterUploadHandler(_handle, name);
+  }
+
   Future<dynamic> evaluateJavascript(String script) async {
     await ready;
     return _plugin.evaluateJavascript(_handle, _jsCallId++, script);
@@ -152,14 +489,115 @@ class WebViewController {
     return _plugin.reload(_handle, bypassCache);
   }
 
+  /// Goes back one page in the session history. Pages are restored from
+  /// WebKit's page cache when possible, without reloading them. Returns
+  /// false if there is no previous page. History doesn't reach past a page
+  /// swapped in from a [prerender].
+  Future<bool> goBack() async {
+    await ready;
+    return _plugin.goBack(_handle);
+  }
+
+  /// Goes forward one page in the session history, see [goBack].
+  Future<bool> goForward() async {
+    await ready;
+    return _plugin.goForward(_handle);
+  }
+
+  /// Goes to the entry at [index] of [getBackForwardList].
+  Future<bool> goToIndex(int index) async {
+    await ready;
+    return _plugin.goToIndex(_handle, index);
+  }
+
+  Future<BackForwardList> getBackForwardList() async {
+    await ready;
+    return _plugin.getBackForwardList(_handle);
+  }
+
+  /// Changes settings of a live webview. [preset] is applied first, then the
+  /// `WebKitSettings` properties in [settings]. Returns false if the preset
+  /// or any of the properties were rejected.
+  Future<bool> updateSettings(
+      {SettingsPreset? preset, Map<String, Object?>? settings}) async {
+    await ready;
+    return _plugin.updateSettings(_handle, preset?.value, settings);
+  }
+
+  /// Renders the visible area, or the whole document if [fullDocument] is
+  /// true, into a PNG image.
+  Future<Uint8List> snapshot({bool fullDocument = false}) async {
+    await ready;
+    return _plugin.snapshot(_handle, fullDocument);
+  }
+
+  /// Returns the resources loaded by the current navigation, as recorded
+  /// natively. Best fetched once [LoadEvent.finished] is received.
+  Future<ResourceTimeline?> getResourceTimeline() async {
+    await ready;
+    return _plugin.getResourceTimeline(_handle);
+  }
+
   Future<void> openInspector() async {
     await ready;
     return _plugin.openInspector(_handle);
   }
 
-  void _update(Rect rect) async {
+  /// Replaces the navigation rules of this webview.
+  ///
+  /// Navigations not matched by any rule get [defaultAction], unless
+  /// [fallback] is provided, in which case it decides asynchronously.
+  Future<void> setNavigationRules(List<NavigationRule> rules,
+      {NavigationAction defaultAction = NavigationAction.allow,
+      Future<NavigationAction> Function(String uri, bool newWindow)?
+          fallback}) async {
+    await ready;
+    return _plugin.setNavigationRules(_handle,
+        rules.map((e) => e._toMap()).toList(), defaultAction, fallback);
+  }
+
+  /// Returns the host id of the Flutter window this isolate's engine renders
+  /// into. Host ids can be shared with other engines to create or move
+  /// webviews into this window.
+  static Future<int> getHost() {
+    return FlutterWebkit().getHost();
+  }
+
+  /// Starts recording native plugin activity, to be written to [path] in
+  /// Chrome trace-event format by [stopTracing]. Tracing can also be enabled
+  /// from startup with the `FLUTTER_WEBKIT_TRACE` environment variable.
+  static Future<bool> startTracing(String path) {
+    return FlutterWebkit().startTracing(path);
+  }
+
+  /// Stops tracing and returns the path of the written trace, if any.
+  static Future<String?> stopTracing() {
+    return FlutterWebkit().stopTracing();
+  }
+
+  /// Returns the records kept in the native log buffer, oldest first. The
+  /// buffer holds the last 1024 records. It is also written to stderr if the
+  /// process crashes and `FLUTTER_WEBKIT_LOG` contains `crash`.
+  static Future<List<LogRecord>> getLogs() {
+    return FlutterWebkit().getLogs();
+  }
+
+  /// Sets the lowest level recorded for [category], or for all categories
+  /// if null. Levels below the one the plugin was built with
+  /// (`FLUTTER_WEBKIT_LOG_LEVEL`) are never recorded.
+  static Future<void> setLogLevel(LogCategory? category, LogLevel level) {
+    return FlutterWebkit().setLogLevel(category, level);
+  }
+
+  /// Moves the webview into the window of [host] without reloading it.
+  Future<bool> moveTo(int host) async {
+    await ready;
+    return _plugin.moveWebView(_handle, host);
+  }
+
+  void _update(Rect rect, Rect? clip) async {
     await ready;
-    _plugin.setDimension(_handle, rect);
+    _plugin.setDimension(_handle, rect, clip);
   }
 
   Future<void> dispose() async {
@@ -0,0 +1,113 @@
+#include "BinaryProtocol.h"
+
+#include <cstring>
+
+BinaryReader::BinaryReader(const uint8_t *data, size_t length)
+    : _data(data), _length(length), _offset(0)
+{
+}
+
+bool BinaryReader::take(void *value, size_t size)
+{
+    if (this->_length - this->_offset < size)
+    {
+        this->_offset = this->_length;
+        return false;
+    }
+
+    memcpy(value, this->_data + this->_offset, size);
+    this->_offset += size;
+    return true;
+}
+
+bool BinaryReader::u8(uint8_t *value)
+{
+    return this->take(value, sizeof(*value));
+}
+
+bool BinaryReader::i32(int32_t *value)
+{
+    guint32 v;
+    if (!this->take(&v, sizeof(v)))
+    {
+        return false;
+    }
+
+    *value = (int32_t)GUINT32_FROM_LE(v);
+    return true;
+}
+
+bool BinaryReader::u64(uint64_t *value)
+{
+    guint64 v;
+    if (!this->take(&v, sizeof(v)))
+    {
+        return false;
+    }
+
+    *value = GUINT64_FROM_LE(v);
+    return true;
+}
+
+void BinaryReader::rest(const uint8_t **data, size_t *length)
+{
+    *data = this->_data + this->_offset;
+    *length = this->_length - this->_offset;
+    this->_offset = this->_length;
+}
+
+BinaryWriter::BinaryWriter(uint8_t opcode)
+    : _buffer(g_byte_array_sized_new(32))
+{
+    this->u8(opcode);
+}
+
+BinaryWriter::~BinaryWriter()
+{
+    if (this->_buffer != NULL)
+    {
+        g_byte_array_unref(this->_buffer);
+    }
+}
+
+void BinaryWriter::u8(uint8_t value)
+{
+    g_byte_array_append(this->_buffer, &value, sizeof(value));
+}
+
+void BinaryWriter::i32(int32_t value)
+{
+    this->u32((uint32_t)value);
+}
+
+void BinaryWriter::u32(uint32_t value)
+{
+    guint32 v = GUINT32_TO_LE(value);
+    g_byte_array_append(this->_buffer, (const guint8 *)&v, sizeof(v));
+}
+
+void BinaryWriter::u64(uint64_t value)
+{
+    guint64 v = GUINT64_TO_LE(value);
+    g_byte_array_append(this->_buffer, (const guint8 *)&v, sizeof(v));
+}
+
+void BinaryWriter::f64(double value)
+{
+    guint64 v;
+    memcpy(&v, &value, sizeof(v));
+    this->u64(v);
+}
+
+void BinaryWriter::bytes(const void *data, size_t length)
+{
+    g_byte_array_append(this->_buffer, (const guint8 *)data, length);
+}
+
+FlValue *BinaryWriter::finish()
+{
+    auto value = fl_value_new_uint8_list(this->_buffer->data, this->_buffer->len);
+    g_byte_array_unref(this->_buffer);
+    this->_buffer = NULL;
+    return value;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <cstddef>
+
+// Channel carrying the high-frequency calls and events as compact binary
+// records instead of standard codec maps.
+#define BINARY_CHANNEL "flutter_webkit/binary"
+
+// Every message starts with one of these, followed by a fixed-layout little
+// endian record. Variable length payloads come last and take the rest of
+// the message. Values must match lib/src/binary_protocol.dart.
+enum BinaryOpcode
+{
+    // u64 webview, i32 x, i32 y, i32 w, i32 h, u8 clipped
+    // [, i32 clip_x, i32 clip_y, i32 clip_w, i32 clip_h]
+    BINARY_OP_SET_DIMENSION = 0x01,
+    // u64 webview, u64 id, script
+    // Answered with a BINARY_EVENT_JAVASCRIPT_RESULT record, or nothing if
+    // the webview is not found.
+    BINARY_OP_EVALUATE_JAVASCRIPT = 0x02,
+
+    // u64 webview, u64 id, i32 error, u32 message length, message, json
+    // Sent as an event only for evaluate_javascript method calls.
+    BINARY_EVENT_JAVASCRIPT_RESULT = 0x81,
+    // u64 webview, f64 progress
+    BINARY_EVENT_LOAD_PROGRESS = 0x82,
+    // u64 webview, u8 event
+    BINARY_EVENT_LOAD_CHANGED = 0x83,
+};
+
+// Bounds checked reads, every read fails once the record is exhausted.
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t *data, size_t length);
+
+    bool u8(uint8_t *value);
+    bool i32(int32_t *value);
+    bool u64(uint64_t *value);
+    // Points into the message, not NUL-terminated.
+    void rest(const uint8_t **data, size_t *length);
+
+private:
+    bool take(void *value, size_t size);
+
+    const uint8_t *_data;
+    size_t _length;
+    size_t _offset;
+};
+
+class BinaryWriter
+{
+public:
+    BinaryWriter(uint8_t opcode);
+    ~BinaryWriter();
+
+    void u8(uint8_t value);
+    void i32(int32_t value);
+    void u32(uint32_t value);
+    void u64(uint64_t value);
+    void f64(double value);
+    void bytes(const void *data, size_t length);
+
+    // Returns the message as FL_VALUE_TYPE_UINT8_LIST, the writer can't be
+    // used afterwards.
+    FlValue *finish();
+
+private:
+    GByteArray *_buffer;
+};
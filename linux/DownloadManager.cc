@@ -0,0 +1,410 @@
+#include "DownloadManager.h"
+#include "Log.h"
+#include "Tracing.h"
+#include "WebView.h"
+#include "WebViewManager.h"
+
+#include <algorithm>
+
+// Fix IntelliSense errors
+#ifndef g_autoptr
+#define g_autoptr(x) x *
+#define g_autofree
+#endif
+
+static std::string lookup_string(FlValue *map, const gchar *key)
+{
+    auto value = fl_value_lookup_string(map, key);
+    if (value == NULL || fl_value_get_type(value) != FL_VALUE_TYPE_STRING)
+    {
+        return std::string();
+    }
+
+    return std::string(fl_value_get_string(value));
+}
+
+// Adds " (n)" before the extension until |path| doesn't exist.
+static std::string unique_path(const std::string &directory, const gchar *filename)
+{
+    g_autofree gchar *path = g_build_filename(directory.c_str(), filename, NULL);
+    if (!g_file_test(path, G_FILE_TEST_EXISTS))
+    {
+        return std::string(path);
+    }
+
+    std::string name(filename);
+    auto dot = name.rfind('.');
+    auto stem = dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+    auto extension = dot == std::string::npos || dot == 0 ? std::string() : name.substr(dot);
+
+    for (auto i = 1;; i++)
+    {
+        auto candidate = stem + " (" + std::to_string(i) + ")" + extension;
+        g_autofree gchar *candidate_path = g_build_filename(directory.c_str(), candidate.c_str(), NULL);
+        if (!g_file_test(candidate_path, G_FILE_TEST_EXISTS))
+        {
+            return std::string(candidate_path);
+        }
+    }
+}
+
+DownloadManager::DownloadManager(WebKitWebContext *context, WebViewManager *webviews)
+    : _context(context),
+      _webviews(webviews),
+      _rules(),
+      _default_directory(),
+      _cancel_unmatched(false),
+      _downloads(),
+      _progress_interval(DEFAULT_DOWNLOAD_PROGRESS_INTERVAL_MS),
+      _progress_source(0)
+{
+    auto directory = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+    this->_default_directory = directory != NULL ? directory : g_get_home_dir();
+
+    g_signal_connect(
+        context, "download-started", (GCallback)(+[](WebKitWebContext *context, WebKitDownload *download, gpointer user_data)
+                                                 {
+        auto self = (DownloadManager *)user_data;
+        self->start(download); }),
+        this);
+}
+
+DownloadManager::~DownloadManager()
+{
+    g_signal_handlers_disconnect_by_data(this->_context, this);
+
+    if (this->_progress_source != 0)
+    {
+        g_source_remove(this->_progress_source);
+        this->_progress_source = 0;
+    }
+
+    // Nobody is left to report to, active downloads are stopped.
+    auto downloads = this->_downloads;
+    for (auto d : downloads)
+    {
+        g_signal_handlers_disconnect_by_data(d->download, d);
+        webkit_download_cancel(d->download);
+        this->remove(d);
+    }
+}
+
+void DownloadManager::set_rules(FlValue *rules, const gchar *default_directory, bool cancel_unmatched)
+{
+    this->_rules.clear();
+
+    auto length = fl_value_get_length(rules);
+    for (size_t i = 0; i < length; i++)
+    {
+        auto rule = fl_value_get_list_value(rules, i);
+        if (rule == NULL || fl_value_get_type(rule) != FL_VALUE_TYPE_MAP)
+        {
+            LOG_WARNING(LOG_DOWNLOAD, "Download rule #%zu is ignored as it's not a FL_VALUE_TYPE_MAP.\n", i);
+            continue;
+        }
+
+        auto arg_cancel = fl_value_lookup_string(rule, "cancel");
+        Rule r{
+            .filename = lookup_string(rule, "filename"),
+            .host = lookup_string(rule, "host"),
+            .mime = lookup_string(rule, "mime"),
+            .directory = lookup_string(rule, "directory"),
+            .cancel = arg_cancel != NULL && fl_value_get_type(arg_cancel) == FL_VALUE_TYPE_BOOL && fl_value_get_bool(arg_cancel)};
+
+        if (!r.cancel && r.directory.empty())
+        {
+            LOG_WARNING(LOG_DOWNLOAD, "Download rule #%zu is ignored as it has no directory.\n", i);
+            continue;
+        }
+
+        this->_rules.push_back(r);
+    }
+
+    this->_cancel_unmatched = cancel_unmatched;
+    if (default_directory != NULL)
+    {
+        this->_default_directory = default_directory;
+    }
+    else
+    {
+        auto directory = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+        this->_default_directory = directory != NULL ? directory : g_get_home_dir();
+    }
+}
+
+void DownloadManager::set_progress_interval(int interval_ms)
+{
+    this->_progress_interval = std::max(interval_ms, 1);
+}
+
+bool DownloadManager::cancel(uint64_t id)
+{
+    auto pos = std::find(this->_downloads.begin(), this->_downloads.end(), (Download *)id);
+    if (pos == this->_downloads.end())
+    {
+        return false;
+    }
+
+    // Reported to Dart through "failed", as WebKit does.
+    webkit_download_cancel((*pos)->download);
+    return true;
+}
+
+const DownloadManager::Rule *DownloadManager::match(WebKitDownload *download, const gchar *filename) const
+{
+    auto request = webkit_download_get_request(download);
+    auto response = webkit_download_get_response(download);
+
+    std::string host;
+    auto uri = g_uri_parse(webkit_uri_request_get_uri(request), G_URI_FLAGS_NONE, NULL);
+    if (uri != NULL)
+    {
+        auto h = g_uri_get_host(uri);
+        if (h != NULL)
+        {
+            g_autofree gchar *lower = g_ascii_strdown(h, -1);
+            host = lower;
+        }
+        g_uri_unref(uri);
+    }
+
+    auto mime = response == NULL ? NULL : webkit_uri_response_get_mime_type(response);
+
+    for (auto &rule : this->_rules)
+    {
+        if (!rule.filename.empty() && !g_pattern_match_simple(rule.filename.c_str(), filename))
+        {
+            continue;
+        }
+
+        if (!rule.host.empty() && (host.empty() || !g_pattern_match_simple(rule.host.c_str(), host.c_str())))
+        {
+            continue;
+        }
+
+        if (!rule.mime.empty() && (mime == NULL || !g_pattern_match_simple(rule.mime.c_str(), mime)))
+        {
+            continue;
+        }
+
+        return &rule;
+    }
+
+    return NULL;
+}
+
+void DownloadManager::start(WebKitDownload *download)
+{
+    // Downloads of views the plugin doesn't own are left to WebKit.
+    auto web_view = webkit_download_get_web_view(download);
+    auto webview = web_view == NULL ? NULL : (WebView *)g_object_get_data(G_OBJECT(web_view), "flutter-webkit-view");
+    if (webview == NULL)
+    {
+        return;
+    }
+
+    auto d = new Download{
+        .manager = this,
+        .download = WEBKIT_DOWNLOAD(g_object_ref(download)),
+        .channel = FL_METHOD_CHANNEL(g_object_ref(webview->channel())),
+        .webview = (uint64_t)webview,
+        .background = webview->events() != nullptr,
+        .destination = std::string(),
+        .sent_received = 0,
+        .dirty = false,
+        .started = false,
+        .failed = false};
+    this->_downloads.push_back(d);
+
+    webkit_download_set_allow_overwrite(download, FALSE);
+
+    g_signal_connect(
+        download, "decide-destination", (GCallback)(+[](WebKitDownload *download, gchar *suggested_filename, gpointer user_data) -> gboolean
+                                                    {
+        auto d = (Download *)user_data;
+        return d->manager->decide_destination(d, suggested_filename); }),
+        d);
+
+    // Only marks the download, progress is sent on the next tick.
+    g_signal_connect(
+        download, "received-data", (GCallback)(+[](WebKitDownload *download, guint64 data_length, gpointer user_data)
+                                               {
+        auto d = (Download *)user_data;
+        d->dirty = true;
+        d->manager->schedule_progress(); }),
+        d);
+
+    g_signal_connect(
+        download, "failed", (GCallback)(+[](WebKitDownload *download, GError *error, gpointer user_data)
+                                        {
+        auto d = (Download *)user_data;
+        d->failed = true;
+
+        // Downloads cancelled before a destination was chosen were never
+        // reported as started.
+        if (!d->started)
+        {
+            return;
+        }
+
+        auto cancelled = g_error_matches(error, WEBKIT_DOWNLOAD_ERROR, WEBKIT_DOWNLOAD_ERROR_CANCELLED_BY_USER);
+
+        g_autoptr(FlValue) r = fl_value_new_map();
+        fl_value_set_string_take(r, "download", fl_value_new_int((uint64_t)d));
+        fl_value_set_string_take(r, "cancelled", fl_value_new_bool(cancelled));
+        fl_value_set_string_take(r, "message", fl_value_new_string(error->message));
+        d->manager->send_event(d, "on_download_failed", r); }),
+        d);
+
+    // Also emitted after "failed".
+    g_signal_connect(
+        download, "finished", (GCallback)(+[](WebKitDownload *download, gpointer user_data)
+                                          {
+        auto d = (Download *)user_data;
+        if (!d->failed)
+        {
+            g_autoptr(FlValue) r = fl_value_new_map();
+            fl_value_set_string_take(r, "download", fl_value_new_int((uint64_t)d));
+            fl_value_set_string_take(r, "destination", fl_value_new_string(d->destination.c_str()));
+            fl_value_set_string_take(r, "size", fl_value_new_int(webkit_download_get_received_data_length(download)));
+            d->manager->send_event(d, "on_download_finished", r);
+        }
+
+        d->manager->remove(d); }),
+        d);
+}
+
+bool DownloadManager::decide_destination(Download *d, const gchar *suggested_filename)
+{
+    // Never trust a server-provided name with a path in it.
+    g_autofree gchar *filename = g_path_get_basename(suggested_filename != NULL && suggested_filename[0] != '\0' ? suggested_filename : "download");
+    if (g_strcmp0(filename, ".") == 0 || g_strcmp0(filename, "..") == 0 || g_strcmp0(filename, G_DIR_SEPARATOR_S) == 0)
+    {
+        g_free(filename);
+        filename = g_strdup("download");
+    }
+
+    auto rule = this->match(d->download, filename);
+    if ((rule == NULL && this->_cancel_unmatched) || (rule != NULL && rule->cancel))
+    {
+        webkit_download_cancel(d->download);
+        return TRUE;
+    }
+
+    auto &directory = rule == NULL ? this->_default_directory : rule->directory;
+    if (g_mkdir_with_parents(directory.c_str(), 0755) != 0)
+    {
+        LOG_WARNING(LOG_DOWNLOAD, "Unable to create download directory '%s'.\n", directory.c_str());
+        webkit_download_cancel(d->download);
+        return TRUE;
+    }
+
+    d->destination = unique_path(directory, filename);
+
+    g_autofree gchar *uri = g_filename_to_uri(d->destination.c_str(), NULL, NULL);
+    webkit_download_set_destination(d->download, uri);
+
+    auto response = webkit_download_get_response(d->download);
+    auto request = webkit_download_get_request(d->download);
+
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "download", fl_value_new_int((uint64_t)d));
+    fl_value_set_string_take(r, "uri", fl_value_new_string(webkit_uri_request_get_uri(request)));
+    fl_value_set_string_take(r, "destination", fl_value_new_string(d->destination.c_str()));
+    fl_value_set_string_take(r, "total", fl_value_new_int(response == NULL ? 0 : webkit_uri_response_get_content_length(response)));
+    d->started = true;
+    this->send_event(d, "on_download_started", r);
+
+    return TRUE;
+}
+
+void DownloadManager::schedule_progress()
+{
+    if (this->_progress_source != 0)
+    {
+        return;
+    }
+
+    this->_progress_source = g_timeout_add(
+        this->_progress_interval,
+        +[](gpointer user_data) -> gboolean
+        {
+            auto self = (DownloadManager *)user_data;
+            if (self->flush_progress())
+            {
+                return G_SOURCE_CONTINUE;
+            }
+
+            self->_progress_source = 0;
+            return G_SOURCE_REMOVE;
+        },
+        this);
+}
+
+// Returns false once no download made progress, the timer then stops.
+bool DownloadManager::flush_progress()
+{
+    TRACE_SCOPE("download_progress");
+
+    auto active = false;
+    for (auto d : this->_downloads)
+    {
+        if (!d->dirty || d->destination.empty())
+        {
+            continue;
+        }
+
+        active = true;
+        d->dirty = false;
+
+        auto received = webkit_download_get_received_data_length(d->download);
+        if (received == d->sent_received)
+        {
+            continue;
+        }
+        d->sent_received = received;
+
+        auto response = webkit_download_get_response(d->download);
+
+        g_autoptr(FlValue) r = fl_value_new_map();
+        fl_value_set_string_take(r, "download", fl_value_new_int((uint64_t)d));
+        fl_value_set_string_take(r, "received", fl_value_new_int(received));
+        fl_value_set_string_take(r, "total", fl_value_new_int(response == NULL ? 0 : webkit_uri_response_get_content_length(response)));
+        this->send_event(d, "on_download_progress", r);
+    }
+
+    return active;
+}
+
+// |args| stays owned by the caller.
+void DownloadManager::send_event(Download *d, const gchar *method, FlValue *args)
+{
+    fl_value_set_string_take(args, "webview", fl_value_new_int(d->webview));
+
+    // Downloads outlive their view. Events of a view owned by a background
+    // isolate go through its queue while it exists and are dropped after,
+    // the root isolate has no listener for them.
+    auto webview = this->_webviews->find_webview(d->webview);
+    if (webview != NULL)
+    {
+        webview->send_download_event(method, args);
+    }
+    else if (!d->background)
+    {
+        fl_method_channel_invoke_method(d->channel, method, args, NULL, NULL, NULL);
+    }
+}
+
+void DownloadManager::remove(Download *d)
+{
+    auto pos = std::find(this->_downloads.begin(), this->_downloads.end(), d);
+    if (pos != this->_downloads.end())
+    {
+        this->_downloads.erase(pos);
+    }
+
+    g_signal_handlers_disconnect_by_data(d->download, d);
+    g_object_unref(d->download);
+    g_object_unref(d->channel);
+    delete d;
+}
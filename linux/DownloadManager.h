@@ -0,0 +1,71 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+#include <webkitgtk-4.1/webkit2/webkit2.h>
+
+#include <string>
+#include <vector>
+
+#define DEFAULT_DOWNLOAD_PROGRESS_INTERVAL_MS 250
+
+class WebViewManager;
+
+// Handles downloads started by plugin webviews.
+//
+// Destinations are decided natively from rules set by Dart, WebKit then
+// writes the data straight to disk. Dart only gets started, finished and
+// failed events, plus progress of all active downloads coalesced to one
+// event per download per progress interval.
+class DownloadManager
+{
+public:
+    DownloadManager(WebKitWebContext *context, WebViewManager *webviews);
+    ~DownloadManager();
+
+    // Rules are matched in order. Downloads matched by none are cancelled
+    // if |cancel_unmatched|, or saved to |default_directory| (the XDG
+    // download directory if NULL).
+    void set_rules(FlValue *rules, const gchar *default_directory, bool cancel_unmatched);
+    void set_progress_interval(int interval_ms);
+    bool cancel(uint64_t id);
+
+private:
+    struct Rule
+    {
+        std::string filename;
+        std::string host;
+        std::string mime;
+        std::string directory;
+        bool cancel;
+    };
+
+    struct Download
+    {
+        DownloadManager *manager;
+        WebKitDownload *download;
+        FlMethodChannel *channel;
+        uint64_t webview;
+        bool background;
+        std::string destination;
+        guint64 sent_received;
+        bool dirty;
+        bool started;
+        bool failed;
+    };
+
+    void start(WebKitDownload *download);
+    bool decide_destination(Download *d, const gchar *suggested_filename);
+    const Rule *match(WebKitDownload *download, const gchar *filename) const;
+    void schedule_progress();
+    bool flush_progress();
+    void send_event(Download *d, const gchar *method, FlValue *args);
+    void remove(Download *d);
+
+    WebKitWebContext *_context;
+    WebViewManager *_webviews;
+    std::vector<Rule> _rules;
+    std::string _default_directory;
+    bool _cancel_unmatched;
+    std::vector<Download *> _downloads;
+    int _progress_interval;
+    guint _progress_source;
+};
@@ -0,0 +1,174 @@
+#include "EventQueue.h"
+#include "Log.h"
+
+static void respond(FlMethodCall *method_call, FlValue *result)
+{
+    g_autoptr(GError) err = NULL;
+    if (!fl_method_call_respond_success(method_call, result, &err))
+    {
+        LOG_WARNING(LOG_WEBVIEW, "Unable to deliver queued events: %s\n", err->message);
+    }
+}
+
+EventQueue::EventQueue(size_t capacity)
+    : _capacity(capacity),
+      _events(),
+      _poll(nullptr),
+      _flush_source(0),
+      _next_request(1),
+      _requests()
+{
+}
+
+EventQueue::~EventQueue()
+{
+    if (this->_flush_source != 0)
+    {
+        g_source_remove(this->_flush_source);
+        this->_flush_source = 0;
+    }
+
+    // A null answer ends the poll loop of the owning isolate.
+    if (this->_poll != nullptr)
+    {
+        respond(this->_poll, NULL);
+        g_object_unref(this->_poll);
+        this->_poll = nullptr;
+    }
+
+    for (auto event : this->_events)
+    {
+        fl_value_unref(event);
+    }
+    this->_events.clear();
+
+    auto requests = std::move(this->_requests);
+    for (auto &it : requests)
+    {
+        it.second.first(NULL, it.second.second);
+    }
+}
+
+void EventQueue::push(const gchar *method, FlValue *args)
+{
+    auto event = fl_value_new_map();
+    fl_value_set_string_take(event, "method", fl_value_new_string(method));
+    fl_value_set_string(event, "args", args);
+    this->enqueue(event);
+}
+
+void EventQueue::push_binary(FlValue *message)
+{
+    auto event = fl_value_new_map();
+    fl_value_set_string(event, "binary", message);
+    this->enqueue(event);
+}
+
+void EventQueue::request(const gchar *method, FlValue *args, ReplyCallback callback, gpointer user_data)
+{
+    auto id = this->_next_request++;
+    this->_requests[id] = std::make_pair(callback, user_data);
+
+    auto event = fl_value_new_map();
+    fl_value_set_string_take(event, "method", fl_value_new_string(method));
+    fl_value_set_string(event, "args", args);
+    fl_value_set_string_take(event, "request", fl_value_new_int(id));
+    this->enqueue(event);
+}
+
+bool EventQueue::reply(int64_t request, FlValue *result)
+{
+    auto it = this->_requests.find(request);
+    if (it == this->_requests.end())
+    {
+        return false;
+    }
+
+    auto callback = it->second;
+    this->_requests.erase(it);
+    callback.first(result, callback.second);
+    return true;
+}
+
+void EventQueue::poll(FlMethodCall *method_call)
+{
+    // Only one poll is outstanding, an older one is answered empty.
+    if (this->_poll != nullptr)
+    {
+        g_autoptr(FlValue) empty = fl_value_new_list();
+        respond(this->_poll, empty);
+        g_object_unref(this->_poll);
+    }
+
+    this->_poll = FL_METHOD_CALL(g_object_ref(method_call));
+    if (!this->_events.empty())
+    {
+        this->schedule_flush();
+    }
+}
+
+void EventQueue::enqueue(FlValue *event)
+{
+    // An isolate that stopped polling must not grow the queue forever.
+    if (this->_events.size() >= this->_capacity)
+    {
+        LOG_WARNING(LOG_WEBVIEW, "Event queue is full, dropping the oldest event.\n");
+        auto oldest = this->_events.front();
+        this->_events.pop_front();
+        this->drop_request(oldest);
+        fl_value_unref(oldest);
+    }
+
+    this->_events.push_back(event);
+    if (this->_poll != nullptr)
+    {
+        this->schedule_flush();
+    }
+}
+
+void EventQueue::schedule_flush()
+{
+    if (this->_flush_source != 0)
+    {
+        return;
+    }
+
+    this->_flush_source = g_idle_add(
+        +[](gpointer user_data) -> gboolean
+        {
+            auto self = (EventQueue *)user_data;
+            self->_flush_source = 0;
+            self->flush();
+            return G_SOURCE_REMOVE;
+        },
+        this);
+}
+
+void EventQueue::flush()
+{
+    if (this->_poll == nullptr || this->_events.empty())
+    {
+        return;
+    }
+
+    g_autoptr(FlValue) events = fl_value_new_list();
+    for (auto event : this->_events)
+    {
+        fl_value_append_take(events, event);
+    }
+    this->_events.clear();
+
+    auto poll = this->_poll;
+    this->_poll = nullptr;
+    respond(poll, events);
+    g_object_unref(poll);
+}
+
+void EventQueue::drop_request(FlValue *event)
+{
+    auto request = fl_value_lookup_string(event, "request");
+    if (request != NULL)
+    {
+        this->reply(fl_value_get_int(request), NULL);
+    }
+}
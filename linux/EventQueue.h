@@ -0,0 +1,44 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+
+#include <deque>
+#include <map>
+#include <utility>
+
+#define DEFAULT_EVENT_QUEUE_CAPACITY 4096
+
+// Events of a view owned by a background isolate.
+//
+// Flutter only delivers messages sent from native code to the root isolate,
+// so events of these views are queued instead and picked up by the owning
+// isolate with a long-polling poll_events call. Each poll is answered with
+// all events queued by the next idle. Events that expect a result carry a
+// request id that the isolate answers with reply_event.
+class EventQueue
+{
+public:
+    // |result| is NULL if the request was dropped or the queue destroyed.
+    typedef void (*ReplyCallback)(FlValue *result, gpointer user_data);
+
+    EventQueue(size_t capacity);
+    ~EventQueue();
+
+    void push(const gchar *method, FlValue *args);
+    void push_binary(FlValue *message);
+    void request(const gchar *method, FlValue *args, ReplyCallback callback, gpointer user_data);
+    bool reply(int64_t request, FlValue *result);
+    void poll(FlMethodCall *method_call);
+
+private:
+    void enqueue(FlValue *event);
+    void schedule_flush();
+    void flush();
+    void drop_request(FlValue *event);
+
+    size_t _capacity;
+    std::deque<FlValue *> _events;
+    FlMethodCall *_poll;
+    guint _flush_source;
+    int64_t _next_request;
+    std::map<int64_t, std::pair<ReplyCallback, gpointer>> _requests;
+};
@@ -0,0 +1,312 @@
+#include "Log.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdarg>
+#include <cstring>
+
+#define LOG_BUFFER_CAPACITY 1024
+#define LOG_MESSAGE_LENGTH 200
+
+// |seq| is odd while a writer fills the record and 2 * (index + 1) once it
+// is complete, so readers can detect torn or overwritten records.
+typedef struct
+{
+    std::atomic<uint64_t> seq;
+    gint64 ts;
+    uint8_t level;
+    uint8_t category;
+    char message[LOG_MESSAGE_LENGTH];
+} log_record_t;
+
+// Runtime levels start at info, before init_from_env runs too.
+std::atomic<int> Log::_levels[LOG_CATEGORY_COUNT] = {
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+};
+static_assert(LOG_CATEGORY_COUNT == 8, "Every category needs a default level.");
+
+static std::atomic<uint64_t> head(0);
+static log_record_t records[LOG_BUFFER_CAPACITY];
+
+static const int crash_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+static struct sigaction previous_actions[G_N_ELEMENTS(crash_signals)];
+
+static const char *category_names[LOG_CATEGORY_COUNT] = {
+    "plugin",
+    "manager",
+    "webview",
+    "navigation",
+    "settings",
+    "download",
+    "upload",
+    "tracing",
+};
+
+static const char *level_names[] = {"debug", "info", "warning", "error", "none"};
+
+static int parse_level(const gchar *name)
+{
+    for (int i = 0; i < (int)G_N_ELEMENTS(level_names); i++)
+    {
+        if (g_ascii_strcasecmp(name, level_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int parse_category(const gchar *name)
+{
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++)
+    {
+        if (g_ascii_strcasecmp(name, category_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Only async-signal-safe calls from here on.
+static void write_string(const char *s)
+{
+    auto length = strlen(s);
+    while (length > 0)
+    {
+        auto n = write(STDERR_FILENO, s, length);
+        if (n <= 0)
+        {
+            return;
+        }
+        s += n;
+        length -= n;
+    }
+}
+
+static void write_number(uint64_t value)
+{
+    char digits[21];
+    auto p = digits + sizeof(digits);
+    *--p = '\0';
+    do
+    {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    write_string(p);
+}
+
+static void crash_handler(int sig, siginfo_t *info, void *context)
+{
+    // Put the previous handlers back first, so a fault they don't recover
+    // from goes straight to them instead of dumping again.
+    size_t previous = 0;
+    for (size_t i = 0; i < G_N_ELEMENTS(crash_signals); i++)
+    {
+        sigaction(crash_signals[i], &previous_actions[i], NULL);
+        if (crash_signals[i] == sig)
+        {
+            previous = i;
+        }
+    }
+
+    write_string("flutter_webkit: crashed, dumping log buffer.\n");
+
+    auto end = head.load(std::memory_order_acquire);
+    auto begin = end > LOG_BUFFER_CAPACITY ? end - LOG_BUFFER_CAPACITY : 0;
+    for (auto i = begin; i < end; i++)
+    {
+        auto &r = records[i % LOG_BUFFER_CAPACITY];
+        if (r.seq.load(std::memory_order_acquire) != 2 * (i + 1))
+        {
+            continue;
+        }
+
+        write_number(r.ts);
+        write_string(" ");
+        write_string(level_names[r.level]);
+        write_string(" ");
+        write_string(category_names[r.category]);
+        write_string(": ");
+        write_string(r.message);
+        write_string("\n");
+    }
+
+    // Hand the signal with its siginfo and context to whoever was installed
+    // before us. Without a handler, returning re-executes a faulting
+    // instruction, which now takes the default action with the original
+    // fault, and abort() raises again itself.
+    auto &action = previous_actions[previous];
+    if (action.sa_flags & SA_SIGINFO)
+    {
+        action.sa_sigaction(sig, info, context);
+    }
+    else if (action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)
+    {
+        action.sa_handler(sig);
+    }
+}
+
+void Log::init_from_env()
+{
+    static bool initialized = false;
+    if (initialized)
+    {
+        return;
+    }
+    initialized = true;
+
+    auto crash_dump = false;
+    auto spec = g_getenv("FLUTTER_WEBKIT_LOG");
+    if (spec != NULL)
+    {
+        g_auto(GStrv) entries = g_strsplit(spec, ",", -1);
+        for (auto entry = entries; *entry != NULL; entry++)
+        {
+            g_auto(GStrv) parts = g_strsplit(g_strstrip(*entry), "=", 2);
+            if (parts[0] == NULL)
+            {
+                continue;
+            }
+
+            if (parts[1] == NULL)
+            {
+                if (g_ascii_strcasecmp(parts[0], "crash") == 0)
+                {
+                    crash_dump = true;
+                    continue;
+                }
+
+                auto level = parse_level(parts[0]);
+                if (level >= 0)
+                {
+                    set_level(level);
+                }
+                continue;
+            }
+
+            auto category = parse_category(parts[0]);
+            auto level = parse_level(parts[1]);
+            if (category >= 0 && level >= 0)
+            {
+                set_level((LogCategory)category, level);
+            }
+        }
+    }
+
+    // Crash handlers are process-wide, the engine or a crash reporter may
+    // have their own, so the dump is opt-in.
+    if (!crash_dump)
+    {
+        return;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = crash_handler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < G_N_ELEMENTS(crash_signals); i++)
+    {
+        sigaction(crash_signals[i], &action, &previous_actions[i]);
+    }
+}
+
+void Log::set_level(LogCategory category, int level)
+{
+    _levels[category].store(CLAMP(level, LOG_LEVEL_DEBUG, LOG_LEVEL_NONE), std::memory_order_relaxed);
+}
+
+void Log::set_level(int level)
+{
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++)
+    {
+        set_level((LogCategory)i, level);
+    }
+}
+
+void Log::write(LogCategory category, int level, const char *format, ...)
+{
+    auto index = head.fetch_add(1, std::memory_order_relaxed);
+    auto &r = records[index % LOG_BUFFER_CAPACITY];
+
+    r.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    r.ts = g_get_real_time();
+    r.level = level;
+    r.category = category;
+
+    va_list args;
+    va_start(args, format);
+    auto length = g_vsnprintf(r.message, LOG_MESSAGE_LENGTH, format, args);
+    va_end(args);
+
+    // Call sites follow glib in ending messages with a newline.
+    length = MIN(length, LOG_MESSAGE_LENGTH - 1);
+    while (length > 0 && r.message[length - 1] == '\n')
+    {
+        r.message[--length] = '\0';
+    }
+
+    r.seq.store(2 * (index + 1), std::memory_order_release);
+
+    if (level >= LOG_LEVEL_WARNING)
+    {
+        g_log(G_LOG_DOMAIN,
+              level >= LOG_LEVEL_ERROR ? G_LOG_LEVEL_CRITICAL : G_LOG_LEVEL_WARNING,
+              "%s", r.message);
+    }
+}
+
+FlValue *Log::to_fl_value()
+{
+    auto list = fl_value_new_list();
+
+    auto end = head.load(std::memory_order_acquire);
+    auto begin = end > LOG_BUFFER_CAPACITY ? end - LOG_BUFFER_CAPACITY : 0;
+    for (auto i = begin; i < end; i++)
+    {
+        auto &r = records[i % LOG_BUFFER_CAPACITY];
+
+        auto seq = r.seq.load(std::memory_order_acquire);
+        if (seq != 2 * (i + 1))
+        {
+            continue;
+        }
+
+        auto ts = r.ts;
+        auto level = r.level;
+        auto category = r.category;
+        char message[LOG_MESSAGE_LENGTH];
+        memcpy(message, r.message, LOG_MESSAGE_LENGTH);
+        message[LOG_MESSAGE_LENGTH - 1] = '\0';
+
+        // Skip records a writer started overwriting while we copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (r.seq.load(std::memory_order_relaxed) != seq)
+        {
+            continue;
+        }
+
+        auto value = fl_value_new_map();
+        fl_value_set_string_take(value, "time", fl_value_new_int(ts));
+        fl_value_set_string_take(value, "level", fl_value_new_int(level));
+        fl_value_set_string_take(value, "category", fl_value_new_int(category));
+        fl_value_set_string_take(value, "message", fl_value_new_string(message));
+        fl_value_append_take(list, value);
+    }
+
+    return list;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Structured logging into an in-memory ring buffer.
+//
+// Records below FLUTTER_WEBKIT_LOG_LEVEL are compiled out, the rest are
+// filtered by a per-category level at runtime before any formatting
+// happens. Records are kept in a fixed-size ring buffer that Dart can dump
+// with get_logs. Warnings and errors are also passed on to glib.
+//
+// Runtime levels start at info and can be set with set_log_level or the
+// FLUTTER_WEBKIT_LOG environment variable, either as a single level
+// ("debug") or per category ("webview=debug,download=warning"). Adding
+// "crash" to it also writes the buffer to stderr on a crash, before the
+// previously installed handler runs.
+
+// Plain defines so they can be compared by the preprocessor. Values match
+// the Dart LogLevel enum.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef FLUTTER_WEBKIT_LOG_LEVEL
+#ifdef NDEBUG
+#define FLUTTER_WEBKIT_LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define FLUTTER_WEBKIT_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Values match the Dart LogCategory enum.
+enum LogCategory
+{
+    LOG_PLUGIN = 0,
+    LOG_MANAGER = 1,
+    LOG_WEBVIEW = 2,
+    LOG_NAVIGATION = 3,
+    LOG_SETTINGS = 4,
+    LOG_DOWNLOAD = 5,
+    LOG_UPLOAD = 6,
+    LOG_TRACING = 7,
+    LOG_CATEGORY_COUNT,
+};
+
+class Log
+{
+public:
+    static void init_from_env();
+
+    static inline bool enabled(LogCategory category, int level)
+    {
+        return level >= _levels[category].load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogCategory category, int level);
+    static void set_level(int level);
+
+    // Formats straight into the next ring buffer slot, messages longer than
+    // a slot are truncated.
+    static void write(LogCategory category, int level, const char *format, ...) G_GNUC_PRINTF(3, 4);
+
+    // Returns the buffered records, oldest first, as a list of maps.
+    static FlValue *to_fl_value();
+
+private:
+    static std::atomic<int> _levels[LOG_CATEGORY_COUNT];
+};
+
+#define LOG_AT(level, category, ...)                 \
+    do                                               \
+    {                                                \
+        if (Log::enabled(category, level))           \
+            Log::write(category, level, __VA_ARGS__); \
+    } while (0)
+
+#if FLUTTER_WEBKIT_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, ...) LOG_AT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if FLUTTER_WEBKIT_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(category, ...) LOG_AT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if FLUTTER_WEBKIT_LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(category, ...) LOG_AT(LOG_LEVEL_WARNING, category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) ((void)0)
+#endif
+
+#if FLUTTER_WEBKIT_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(category, ...) LOG_AT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) ((void)0)
+#endif
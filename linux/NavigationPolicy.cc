@@ -0,0 +1,292 @@
+#include "NavigationPolicy.h"
+#include "Log.h"
+
+#include <climits>
+
+// Fix IntelliSense errors
+#ifndef g_autoptr
+#define g_autoptr(x) x *
+#define g_autofree
+#endif
+
+static const gchar *lookup_string(FlValue *map, const gchar *key)
+{
+    auto value = fl_value_lookup_string(map, key);
+    if (value == NULL || fl_value_get_type(value) != FL_VALUE_TYPE_STRING)
+    {
+        return NULL;
+    }
+
+    return fl_value_get_string(value);
+}
+
+static std::string to_lower(const gchar *s)
+{
+    g_autofree gchar *lower = g_ascii_strdown(s, -1);
+    return std::string(lower);
+}
+
+static std::string escape(const std::string &s)
+{
+    g_autofree gchar *escaped = g_regex_escape_string(s.c_str(), -1);
+    return std::string(escaped);
+}
+
+// Paths of URIs with an authority always start with a slash in the canonical form.
+static std::string host_path(const gchar *path)
+{
+    if (path == NULL)
+    {
+        return std::string("/");
+    }
+
+    return path[0] == '/' ? std::string(path) : std::string("/") + path;
+}
+
+NavigationPolicy::NavigationPolicy()
+    : _trie(), _regexes(), _actions()
+{
+}
+
+NavigationPolicy::~NavigationPolicy()
+{
+    this->clear();
+}
+
+void NavigationPolicy::clear()
+{
+    this->_trie.children.clear();
+    this->_trie.rule = -1;
+
+    for (auto &r : this->_regexes)
+    {
+        g_regex_unref(r.regex);
+    }
+    this->_regexes.clear();
+    this->_actions.clear();
+}
+
+bool NavigationPolicy::empty() const
+{
+    return this->_actions.empty();
+}
+
+void NavigationPolicy::compile(FlValue *rules)
+{
+    this->clear();
+
+    auto length = fl_value_get_length(rules);
+    for (size_t i = 0; i < length; i++)
+    {
+        auto rule = fl_value_get_list_value(rules, i);
+        if (!this->add_rule(rule, this->_actions.size()))
+        {
+            LOG_WARNING(LOG_NAVIGATION, "Navigation rule #%zu is ignored as it's not valid.\n", i);
+        }
+    }
+}
+
+bool NavigationPolicy::add_rule(FlValue *rule, int index)
+{
+    if (rule == NULL || fl_value_get_type(rule) != FL_VALUE_TYPE_MAP)
+    {
+        return false;
+    }
+
+    auto arg_action = fl_value_lookup_string(rule, "action");
+    if (arg_action == NULL || fl_value_get_type(arg_action) != FL_VALUE_TYPE_INT)
+    {
+        return false;
+    }
+
+    auto action = fl_value_get_int(arg_action);
+    if (action < NAVIGATION_ACTION_ALLOW || action > NAVIGATION_ACTION_EXTERNAL)
+    {
+        return false;
+    }
+
+    auto prefix = lookup_string(rule, "prefix");
+    auto regex = lookup_string(rule, "regex");
+    auto scheme = lookup_string(rule, "scheme");
+    auto host = lookup_string(rule, "host");
+    auto path = lookup_string(rule, "path");
+
+    if (prefix != NULL)
+    {
+        this->add_prefix(prefix, index);
+    }
+    else if (regex != NULL)
+    {
+        if (!this->add_regex(regex, index))
+        {
+            return false;
+        }
+    }
+    else if (scheme != NULL || host != NULL || path != NULL)
+    {
+        auto wildcard = host != NULL && g_str_has_prefix(host, "*.");
+
+        // A path without a host may follow any authority, that needs the
+        // regex set.
+        if (scheme != NULL && !wildcard && (host != NULL || path == NULL))
+        {
+            // Fully literal, goes into the trie.
+            auto key = to_lower(scheme) + ":";
+            if (host != NULL)
+            {
+                key += "//" + to_lower(host) + host_path(path);
+            }
+
+            this->add_prefix(key, index);
+        }
+        else
+        {
+            std::string pattern("^");
+            pattern += scheme != NULL ? escape(to_lower(scheme)) : "[a-z][a-z0-9+.-]*";
+            pattern += ":";
+
+            if (host != NULL)
+            {
+                pattern += "//";
+                pattern += wildcard ? "([^/]*\\.)?" + escape(to_lower(host + 2)) : escape(to_lower(host));
+                pattern += escape(host_path(path));
+            }
+            else if (path != NULL)
+            {
+                pattern += "(//[^/]*)?" + escape(path);
+            }
+
+            if (!this->add_regex(pattern.c_str(), index))
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    this->_actions.push_back((NavigationAction)action);
+    return true;
+}
+
+void NavigationPolicy::add_prefix(const std::string &prefix, int index)
+{
+    auto node = &this->_trie;
+    for (auto c : prefix)
+    {
+        auto &child = node->children[c];
+        if (!child)
+        {
+            child.reset(new TrieNode());
+        }
+        node = child.get();
+    }
+
+    // Rules are added in declaration order, so an existing rule always wins.
+    if (node->rule < 0)
+    {
+        node->rule = index;
+    }
+}
+
+bool NavigationPolicy::add_regex(const gchar *pattern, int index)
+{
+    GError *err = NULL;
+    auto regex = g_regex_new(pattern, G_REGEX_OPTIMIZE, (GRegexMatchFlags)0, &err);
+    if (regex == NULL)
+    {
+        LOG_WARNING(LOG_NAVIGATION, "Invalid navigation rule pattern '%s': %s\n", pattern, err->message);
+        g_error_free(err);
+        return false;
+    }
+
+    this->_regexes.push_back(RegexRule{.rule = index, .regex = regex});
+    return true;
+}
+
+bool NavigationPolicy::canonicalize(const gchar *uri, std::string &key)
+{
+    auto parsed = g_uri_parse(uri, G_URI_FLAGS_ENCODED, NULL);
+    if (parsed == NULL)
+    {
+        return false;
+    }
+
+    key = to_lower(g_uri_get_scheme(parsed)) + ":";
+
+    auto host = g_uri_get_host(parsed);
+    auto path = g_uri_get_path(parsed);
+    if (host != NULL)
+    {
+        key += "//" + to_lower(host) + host_path(path);
+    }
+    else
+    {
+        key += path;
+    }
+
+    g_uri_unref(parsed);
+    return true;
+}
+
+bool NavigationPolicy::evaluate(const gchar *uri, NavigationAction *action) const
+{
+    if (this->empty())
+    {
+        return false;
+    }
+
+    std::string key;
+    if (!canonicalize(uri, key))
+    {
+        return false;
+    }
+
+    // Longest walk through the trie, keeping the earliest declared rule seen.
+    int best = INT_MAX;
+    auto node = &this->_trie;
+    if (node->rule >= 0)
+    {
+        best = node->rule;
+    }
+
+    for (auto c : key)
+    {
+        auto pos = node->children.find(c);
+        if (pos == node->children.end())
+        {
+            break;
+        }
+
+        node = pos->second.get();
+        if (node->rule >= 0 && node->rule < best)
+        {
+            best = node->rule;
+        }
+    }
+
+    // Only regex rules declared before the trie match can still win.
+    for (auto &r : this->_regexes)
+    {
+        if (r.rule >= best)
+        {
+            break;
+        }
+
+        if (g_regex_match(r.regex, key.c_str(), (GRegexMatchFlags)0, NULL))
+        {
+            best = r.rule;
+            break;
+        }
+    }
+
+    if (best == INT_MAX)
+    {
+        return false;
+    }
+
+    *action = this->_actions[best];
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Values match the Dart NavigationAction enum.
+enum NavigationAction
+{
+    NAVIGATION_ACTION_ALLOW = 0,
+    NAVIGATION_ACTION_BLOCK = 1,
+    NAVIGATION_ACTION_EXTERNAL = 2,
+};
+
+// A compiled set of navigation rules.
+//
+// URIs are matched against the canonical form "scheme://host/path" (lower
+// case scheme and host, no port, query or fragment). Literal rules live in a
+// prefix trie, wildcard and regex rules in an ordered regex set. Rules are
+// matched in declaration order, the first matching rule wins.
+class NavigationPolicy
+{
+public:
+    NavigationPolicy();
+    ~NavigationPolicy();
+
+    // Replaces the current rule set. Invalid rules are skipped with a warning.
+    void compile(FlValue *rules);
+    void clear();
+    bool empty() const;
+
+    // Returns false if no rule matches |uri|.
+    bool evaluate(const gchar *uri, NavigationAction *action) const;
+
+    static bool canonicalize(const gchar *uri, std::string &key);
+
+private:
+    struct TrieNode
+    {
+        std::map<char, std::unique_ptr<TrieNode>> children;
+        int rule = -1;
+    };
+
+    struct RegexRule
+    {
+        int rule;
+        GRegex *regex;
+    };
+
+    bool add_rule(FlValue *rule, int index);
+    void add_prefix(const std::string &prefix, int index);
+    bool add_regex(const gchar *pattern, int index);
+
+    TrieNode _trie;
+    std::vector<RegexRule> _regexes;
+    std::vector<NavigationAction> _actions;
+};
@@ -0,0 +1,61 @@
+#include "QualityGovernor.h"
+
+QualityGovernor::QualityGovernor(size_t window, size_t overload_windows, size_t headroom_windows, gint64 idle_gap)
+    : _window(window),
+      _overload_windows(overload_windows),
+      _headroom_windows(headroom_windows),
+      _idle_gap(idle_gap),
+      _frames(0),
+      _slow_frames(0),
+      _overloaded(0),
+      _headroom(0)
+{
+}
+
+QualityGovernor::Decision QualityGovernor::frame(gint64 interval, gint64 refresh_interval)
+{
+    if (interval <= 0 || refresh_interval <= 0 || interval > this->_idle_gap)
+    {
+        return HOLD;
+    }
+
+    this->_frames++;
+    if (2 * interval > 3 * refresh_interval)
+    {
+        this->_slow_frames++;
+    }
+
+    if (this->_frames < this->_window)
+    {
+        return HOLD;
+    }
+
+    auto overloaded = 5 * this->_slow_frames > this->_frames;
+    auto headroom = 20 * this->_slow_frames < this->_frames;
+    this->_frames = 0;
+    this->_slow_frames = 0;
+
+    this->_overloaded = overloaded ? this->_overloaded + 1 : 0;
+    this->_headroom = headroom ? this->_headroom + 1 : 0;
+
+    if (this->_overloaded >= this->_overload_windows)
+    {
+        this->_overloaded = 0;
+        return STEP_DOWN;
+    }
+    if (this->_headroom >= this->_headroom_windows)
+    {
+        this->_headroom = 0;
+        return STEP_UP;
+    }
+
+    return HOLD;
+}
+
+void QualityGovernor::reset()
+{
+    this->_frames = 0;
+    this->_slow_frames = 0;
+    this->_overloaded = 0;
+    this->_headroom = 0;
+}
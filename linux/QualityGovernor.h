@@ -0,0 +1,50 @@
+#pragma once
+#include <glib.h>
+
+#include <cstddef>
+
+#define DEFAULT_QUALITY_WINDOW 60
+#define DEFAULT_QUALITY_OVERLOAD_WINDOWS 2
+#define DEFAULT_QUALITY_HEADROOM_WINDOWS 5
+#define DEFAULT_QUALITY_IDLE_GAP (G_USEC_PER_SEC / 2)
+
+// Decides when webviews of a window should trade render quality for frame
+// rate, from the intervals between frame clock ticks.
+//
+// Frames are judged in windows of |window| frames. A frame is slow when it
+// took more than 1.5 refresh intervals. A window with over 20% slow frames
+// is overloaded, one with under 5% has headroom. Quality steps down after
+// |overload_windows| overloaded windows in a row, and back up only after
+// |headroom_windows| windows with headroom, so it doesn't flap.
+//
+// The frame clock keeps ticking while the governor watches it, so a long
+// interval is a slow frame however long it is. Only gaps over |idle_gap|,
+// where the clock was stopped (a hidden window, a suspended process), are
+// ignored.
+class QualityGovernor
+{
+public:
+    QualityGovernor(size_t window, size_t overload_windows, size_t headroom_windows,
+                    gint64 idle_gap = DEFAULT_QUALITY_IDLE_GAP);
+
+    enum Decision
+    {
+        HOLD,
+        STEP_DOWN,
+        STEP_UP,
+    };
+
+    // Both in microseconds.
+    Decision frame(gint64 interval, gint64 refresh_interval);
+    void reset();
+
+private:
+    size_t _window;
+    size_t _overload_windows;
+    size_t _headroom_windows;
+    gint64 _idle_gap;
+    size_t _frames;
+    size_t _slow_frames;
+    size_t _overloaded;
+    size_t _headroom;
+};
@@ -0,0 +1,136 @@
+#include "ResourceTimeline.h"
+
+ResourceTimeline::ResourceTimeline(size_t capacity)
+    : _entries(),
+      _capacity(capacity),
+      _dropped(0),
+      _generation(0),
+      _navigation_start(g_get_monotonic_time())
+{
+}
+
+void ResourceTimeline::reset()
+{
+    this->_entries.clear();
+    this->_dropped = 0;
+    this->_generation++;
+    this->_navigation_start = g_get_monotonic_time();
+}
+
+uint32_t ResourceTimeline::generation() const
+{
+    return this->_generation;
+}
+
+int ResourceTimeline::add(const gchar *uri)
+{
+    if (this->_entries.size() >= this->_capacity)
+    {
+        this->_dropped++;
+        return -1;
+    }
+
+    Entry entry{
+        .uri = uri == NULL ? "" : uri,
+        .mime = "",
+        .error = "",
+        .status = 0,
+        .size = 0,
+        .start = g_get_monotonic_time() - this->_navigation_start,
+        .response = -1,
+        .finish = -1,
+        .failed = false};
+    this->_entries.push_back(entry);
+
+    return this->_entries.size() - 1;
+}
+
+ResourceTimeline::Entry *ResourceTimeline::get(uint32_t generation, int index)
+{
+    if (generation != this->_generation || index < 0 || index >= (int)this->_entries.size())
+    {
+        return NULL;
+    }
+
+    return &this->_entries[index];
+}
+
+void ResourceTimeline::set_response(uint32_t generation, int index, WebKitURIResponse *response)
+{
+    auto entry = this->get(generation, index);
+    if (entry == NULL || response == NULL)
+    {
+        return;
+    }
+
+    auto mime = webkit_uri_response_get_mime_type(response);
+    entry->mime = mime == NULL ? "" : mime;
+    entry->status = webkit_uri_response_get_status_code(response);
+    entry->response = g_get_monotonic_time() - this->_navigation_start;
+}
+
+void ResourceTimeline::add_data(uint32_t generation, int index, guint64 length)
+{
+    auto entry = this->get(generation, index);
+    if (entry != NULL)
+    {
+        entry->size += length;
+    }
+}
+
+void ResourceTimeline::finish(uint32_t generation, int index)
+{
+    auto entry = this->get(generation, index);
+    if (entry != NULL)
+    {
+        entry->finish = g_get_monotonic_time() - this->_navigation_start;
+    }
+}
+
+void ResourceTimeline::fail(uint32_t generation, int index, const gchar *reason)
+{
+    auto entry = this->get(generation, index);
+    if (entry != NULL)
+    {
+        entry->finish = g_get_monotonic_time() - this->_navigation_start;
+        entry->failed = true;
+        entry->error = reason == NULL ? "" : reason;
+    }
+}
+
+FlValue *ResourceTimeline::to_fl_value() const
+{
+    auto length = this->_entries.size();
+
+    std::vector<int32_t> status(length);
+    std::vector<int64_t> size(length), start(length), response(length), finish(length);
+    auto uri = fl_value_new_list();
+    auto mime = fl_value_new_list();
+    auto error = fl_value_new_list();
+
+    for (size_t i = 0; i < length; i++)
+    {
+        auto &e = this->_entries[i];
+        status[i] = e.status;
+        size[i] = e.size;
+        start[i] = e.start;
+        response[i] = e.response;
+        finish[i] = e.finish;
+
+        fl_value_append_take(uri, fl_value_new_string(e.uri.c_str()));
+        fl_value_append_take(mime, e.mime.empty() ? fl_value_new_null() : fl_value_new_string(e.mime.c_str()));
+        fl_value_append_take(error, e.failed ? fl_value_new_string(e.error.c_str()) : fl_value_new_null());
+    }
+
+    auto r = fl_value_new_map();
+    fl_value_set_string_take(r, "dropped", fl_value_new_int(this->_dropped));
+    fl_value_set_string_take(r, "uri", uri);
+    fl_value_set_string_take(r, "mime", mime);
+    fl_value_set_string_take(r, "error", error);
+    fl_value_set_string_take(r, "status", fl_value_new_int32_list(status.data(), length));
+    fl_value_set_string_take(r, "size", fl_value_new_int64_list(size.data(), length));
+    fl_value_set_string_take(r, "start", fl_value_new_int64_list(start.data(), length));
+    fl_value_set_string_take(r, "response", fl_value_new_int64_list(response.data(), length));
+    fl_value_set_string_take(r, "finish", fl_value_new_int64_list(finish.data(), length));
+    return r;
+}
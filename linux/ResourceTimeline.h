@@ -0,0 +1,52 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+#include <webkitgtk-4.1/webkit2/webkit2.h>
+
+#include <string>
+#include <vector>
+
+// Bounded per-navigation record of resource loads of a webview.
+//
+// Entries are addressed by index and the generation they were added in, so
+// late signals of resources from a previous navigation are ignored. Once the
+// buffer is full further resources are only counted as dropped.
+class ResourceTimeline
+{
+public:
+    ResourceTimeline(size_t capacity);
+
+    void reset();
+    uint32_t generation() const;
+
+    // Returns -1 if the timeline is full.
+    int add(const gchar *uri);
+    void set_response(uint32_t generation, int index, WebKitURIResponse *response);
+    void add_data(uint32_t generation, int index, guint64 length);
+    void finish(uint32_t generation, int index);
+    void fail(uint32_t generation, int index, const gchar *reason);
+
+    // Structure of arrays, timestamps in microseconds since navigation start.
+    FlValue *to_fl_value() const;
+
+private:
+    struct Entry
+    {
+        std::string uri;
+        std::string mime;
+        std::string error;
+        int32_t status;
+        int64_t size;
+        int64_t start;
+        int64_t response;
+        int64_t finish;
+        bool failed;
+    };
+
+    Entry *get(uint32_t generation, int index);
+
+    std::vector<Entry> _entries;
+    size_t _capacity;
+    size_t _dropped;
+    uint32_t _generation;
+    gint64 _navigation_start;
+};
@@ -0,0 +1,269 @@
+#include "SettingsTable.h"
+#include "Log.h"
+
+#include <cstring>
+#include <string>
+
+typedef bool (*settings_converter_t)(FlValue *value, GParamSpec *pspec, GValue *out);
+
+typedef struct
+{
+    GType fundamental;
+    settings_converter_t convert;
+} settings_converter_entry_t;
+
+typedef struct
+{
+    const gchar *property;
+    gint value;
+} preset_value_t;
+
+typedef struct
+{
+    const gchar *name;
+    const preset_value_t *values;
+} preset_t;
+
+static bool convert_boolean(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    if (fl_value_get_type(value) != FL_VALUE_TYPE_BOOL)
+    {
+        return false;
+    }
+
+    g_value_set_boolean(out, fl_value_get_bool(value));
+    return true;
+}
+
+static bool convert_int(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    if (fl_value_get_type(value) != FL_VALUE_TYPE_INT)
+    {
+        return false;
+    }
+
+    g_value_set_int(out, fl_value_get_int(value));
+    return true;
+}
+
+static bool convert_uint(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    if (fl_value_get_type(value) != FL_VALUE_TYPE_INT || fl_value_get_int(value) < 0)
+    {
+        return false;
+    }
+
+    g_value_set_uint(out, fl_value_get_int(value));
+    return true;
+}
+
+static bool convert_double(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    if (fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT)
+    {
+        g_value_set_double(out, fl_value_get_float(value));
+        return true;
+    }
+
+    if (fl_value_get_type(value) == FL_VALUE_TYPE_INT)
+    {
+        g_value_set_double(out, fl_value_get_int(value));
+        return true;
+    }
+
+    return false;
+}
+
+static bool convert_string(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    if (fl_value_get_type(value) == FL_VALUE_TYPE_NULL)
+    {
+        g_value_set_string(out, NULL);
+        return true;
+    }
+
+    if (fl_value_get_type(value) != FL_VALUE_TYPE_STRING)
+    {
+        return false;
+    }
+
+    g_value_set_string(out, fl_value_get_string(value));
+    return true;
+}
+
+// Enums accept either the numeric value or the nick, e.g. "never".
+static bool convert_enum(FlValue *value, GParamSpec *pspec, GValue *out)
+{
+    auto enum_class = G_PARAM_SPEC_ENUM(pspec)->enum_class;
+
+    GEnumValue *e = NULL;
+    if (fl_value_get_type(value) == FL_VALUE_TYPE_INT)
+    {
+        e = g_enum_get_value(enum_class, fl_value_get_int(value));
+    }
+    else if (fl_value_get_type(value) == FL_VALUE_TYPE_STRING)
+    {
+        e = g_enum_get_value_by_nick(enum_class, fl_value_get_string(value));
+    }
+
+    if (e == NULL)
+    {
+        return false;
+    }
+
+    g_value_set_enum(out, e->value);
+    return true;
+}
+
+static const settings_converter_entry_t converters[] = {
+    {G_TYPE_BOOLEAN, convert_boolean},
+    {G_TYPE_INT, convert_int},
+    {G_TYPE_UINT, convert_uint},
+    {G_TYPE_DOUBLE, convert_double},
+    {G_TYPE_STRING, convert_string},
+    {G_TYPE_ENUM, convert_enum},
+};
+
+// Few processes and caches, no GPU or media features.
+static const preset_value_t low_memory_values[] = {
+    {"enable-page-cache", FALSE},
+    {"enable-webgl", FALSE},
+    {"enable-webaudio", FALSE},
+    {"enable-media-stream", FALSE},
+    {"enable-smooth-scrolling", FALSE},
+    {"enable-dns-prefetching", FALSE},
+    {"media-playback-requires-user-gesture", TRUE},
+    {"hardware-acceleration-policy", WEBKIT_HARDWARE_ACCELERATION_POLICY_NEVER},
+    {NULL, 0},
+};
+
+// Pages loaded and rendered back to back, nobody scrolls or watches media.
+static const preset_value_t throughput_values[] = {
+    {"enable-page-cache", TRUE},
+    {"enable-dns-prefetching", TRUE},
+    {"enable-smooth-scrolling", FALSE},
+    {"media-playback-requires-user-gesture", TRUE},
+    {"enable-write-console-messages-to-stdout", FALSE},
+    {NULL, 0},
+};
+
+// Lowest latency for a user in front of the view. The hardware acceleration
+// policy is left alone here and in throughput, forcing it breaks rendering
+// with software GL, callers can still ask for "always".
+static const preset_value_t interactive_values[] = {
+    {"enable-page-cache", TRUE},
+    {"enable-dns-prefetching", TRUE},
+    {"enable-smooth-scrolling", TRUE},
+    {"enable-webgl", TRUE},
+    {"media-playback-requires-user-gesture", FALSE},
+    {NULL, 0},
+};
+
+static const preset_t presets[] = {
+    {"low-memory", low_memory_values},
+    {"throughput", throughput_values},
+    {"interactive", interactive_values},
+};
+
+static GParamSpec *find_property(WebKitSettings *settings, const gchar *key)
+{
+    std::string name(key);
+    for (auto &c : name)
+    {
+        if (c == '_')
+        {
+            c = '-';
+        }
+    }
+
+    return g_object_class_find_property(G_OBJECT_GET_CLASS(settings), name.c_str());
+}
+
+bool settings_apply_value(WebKitSettings *settings, const gchar *key, FlValue *value)
+{
+    auto pspec = find_property(settings, key);
+    if (pspec == NULL || !(pspec->flags & G_PARAM_WRITABLE))
+    {
+        LOG_WARNING(LOG_SETTINGS, "'%s' is ignored as it's not a writable WebKitSettings property.\n", key);
+        return false;
+    }
+
+    auto fundamental = G_TYPE_FUNDAMENTAL(pspec->value_type);
+    for (auto &converter : converters)
+    {
+        if (converter.fundamental != fundamental)
+        {
+            continue;
+        }
+
+        GValue v = G_VALUE_INIT;
+        g_value_init(&v, pspec->value_type);
+
+        auto ok = converter.convert(value, pspec, &v);
+        if (ok && g_param_value_validate(pspec, &v))
+        {
+            // The value had to be modified to fit, e.g. out of range.
+            ok = false;
+        }
+
+        if (ok)
+        {
+            g_object_set_property(G_OBJECT(settings), pspec->name, &v);
+            LOG_DEBUG(LOG_SETTINGS, "'%s' is set.\n", pspec->name);
+        }
+        else
+        {
+            LOG_WARNING(LOG_SETTINGS, "'%s' is ignored as the value is not a valid %s.\n", key, g_type_name(pspec->value_type));
+        }
+
+        g_value_unset(&v);
+        return ok;
+    }
+
+    LOG_WARNING(LOG_SETTINGS, "'%s' is ignored as %s properties are not supported.\n", key, g_type_name(pspec->value_type));
+    return false;
+}
+
+int settings_apply_values(WebKitSettings *settings, FlValue *values)
+{
+    int rejected = 0;
+
+    auto length = fl_value_get_length(values);
+    for (size_t i = 0; i < length; i++)
+    {
+        auto key = fl_value_get_map_key(values, i);
+        if (fl_value_get_type(key) != FL_VALUE_TYPE_STRING ||
+            !settings_apply_value(settings, fl_value_get_string(key), fl_value_get_map_value(values, i)))
+        {
+            rejected++;
+        }
+    }
+
+    return rejected;
+}
+
+bool settings_apply_preset(WebKitSettings *settings, const gchar *preset)
+{
+    for (auto &p : presets)
+    {
+        if (strcmp(p.name, preset) != 0)
+        {
+            continue;
+        }
+
+        for (auto v = p.values; v->property != NULL; v++)
+        {
+            // Properties may be missing from older WebKitGTK versions.
+            if (g_object_class_find_property(G_OBJECT_GET_CLASS(settings), v->property) != NULL)
+            {
+                g_object_set(settings, v->property, v->value, NULL);
+            }
+        }
+
+        LOG_DEBUG(LOG_SETTINGS, "Applied settings preset '%s'.\n", preset);
+        return true;
+    }
+
+    LOG_WARNING(LOG_SETTINGS, "Unknown settings preset '%s'.\n", preset);
+    return false;
+}
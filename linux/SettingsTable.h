@@ -0,0 +1,18 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+#include <webkitgtk-4.1/webkit2/webkit2.h>
+
+// Maps Dart values onto WebKitSettings properties.
+//
+// Keys are WebKitSettings property names, with '_' accepted in place of '-'.
+// Values are converted according to the GObject type of the property and
+// validated against its GParamSpec before being set.
+
+// Returns false if |key| is not a settings property or |value| doesn't fit it.
+bool settings_apply_value(WebKitSettings *settings, const gchar *key, FlValue *value);
+
+// Applies every entry of |values|, returns the number of rejected entries.
+int settings_apply_values(WebKitSettings *settings, FlValue *values);
+
+// Applies one of the named presets: "low-memory", "throughput" or "interactive".
+bool settings_apply_preset(WebKitSettings *settings, const gchar *preset);
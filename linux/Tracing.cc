@@ -0,0 +1,244 @@
+#include "Tracing.h"
+#include "Log.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define TRACE_BUFFER_CAPACITY 16384
+#define TRACE_ARG_LENGTH 40
+
+typedef struct
+{
+    gint64 ts;
+    uint64_t id;
+    const char *name;
+    char phase;
+    char arg[TRACE_ARG_LENGTH];
+} trace_event_t;
+
+// Written only by its own thread. Once full, the oldest events are overwritten.
+typedef struct
+{
+    std::atomic<uint64_t> head;
+    int tid;
+    trace_event_t events[TRACE_BUFFER_CAPACITY];
+} trace_buffer_t;
+
+std::atomic<bool> Tracing::_enabled(false);
+
+static GMutex buffers_lock;
+static std::vector<trace_buffer_t *> buffers;
+static gchar *output_path = NULL;
+static std::atomic<uint64_t> flow_ids(1);
+static thread_local trace_buffer_t *current_buffer = nullptr;
+
+static trace_buffer_t *get_buffer()
+{
+    if (current_buffer == nullptr)
+    {
+        auto buffer = new trace_buffer_t();
+        buffer->head.store(0);
+        buffer->tid = (int)syscall(SYS_gettid);
+
+        // Only taken once per thread.
+        g_mutex_lock(&buffers_lock);
+        buffers.push_back(buffer);
+        g_mutex_unlock(&buffers_lock);
+
+        current_buffer = buffer;
+    }
+
+    return current_buffer;
+}
+
+static void record(char phase, const char *name, uint64_t id, const char *arg)
+{
+    auto buffer = get_buffer();
+    auto head = buffer->head.load(std::memory_order_relaxed);
+
+    auto &e = buffer->events[head % TRACE_BUFFER_CAPACITY];
+    e.ts = g_get_monotonic_time();
+    e.id = id;
+    e.name = name;
+    e.phase = phase;
+    if (arg != NULL)
+    {
+        g_strlcpy(e.arg, arg, TRACE_ARG_LENGTH);
+    }
+    else
+    {
+        e.arg[0] = '\0';
+    }
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s != '\0'; s++)
+    {
+        auto c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', f);
+            fputc(c, f);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(f, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static bool write_trace(const gchar *path)
+{
+    auto f = fopen(path, "w");
+    if (f == NULL)
+    {
+        LOG_WARNING(LOG_TRACING, "Unable to write trace to '%s'.\n", path);
+        return false;
+    }
+
+    auto pid = (int)getpid();
+    auto first = true;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+
+    g_mutex_lock(&buffers_lock);
+    for (auto buffer : buffers)
+    {
+        auto head = buffer->head.load(std::memory_order_acquire);
+        auto from = head > TRACE_BUFFER_CAPACITY ? head - TRACE_BUFFER_CAPACITY : 0;
+
+        for (auto i = from; i < head; i++)
+        {
+            auto &e = buffer->events[i % TRACE_BUFFER_CAPACITY];
+
+            fputs(first ? "\n" : ",\n", f);
+            first = false;
+
+            fprintf(f, "{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%" G_GINT64_FORMAT ",\"cat\":\"flutter_webkit\",\"name\":",
+                    e.phase, pid, buffer->tid, e.ts);
+            write_json_string(f, e.name);
+
+            if (e.phase == 's' || e.phase == 'f')
+            {
+                fprintf(f, ",\"id\":%" G_GUINT64_FORMAT, e.id);
+                if (e.phase == 'f')
+                {
+                    fputs(",\"bp\":\"e\"", f);
+                }
+            }
+
+            if (e.arg[0] != '\0')
+            {
+                fputs(",\"args\":{\"detail\":", f);
+                write_json_string(f, e.arg);
+                fputc('}', f);
+            }
+
+            fputc('}', f);
+        }
+    }
+    g_mutex_unlock(&buffers_lock);
+
+    fputs("\n]}\n", f);
+    fclose(f);
+    return true;
+}
+
+void Tracing::init_from_env()
+{
+    static bool initialized = false;
+    if (initialized)
+    {
+        return;
+    }
+    initialized = true;
+
+    auto path = g_getenv("FLUTTER_WEBKIT_TRACE");
+    if (path != NULL && path[0] != '\0' && start(path))
+    {
+        atexit([]()
+               { g_free(Tracing::stop()); });
+    }
+}
+
+bool Tracing::start(const gchar *path)
+{
+    if (enabled())
+    {
+        LOG_WARNING(LOG_TRACING, "Tracing is already started.\n");
+        return false;
+    }
+
+    g_mutex_lock(&buffers_lock);
+    for (auto buffer : buffers)
+    {
+        buffer->head.store(0, std::memory_order_relaxed);
+    }
+    g_mutex_unlock(&buffers_lock);
+
+    g_free(output_path);
+    output_path = g_strdup(path);
+
+    _enabled.store(true, std::memory_order_release);
+    LOG_INFO(LOG_TRACING, "Tracing to '%s'.", path);
+    return true;
+}
+
+gchar *Tracing::stop()
+{
+    if (!enabled())
+    {
+        return NULL;
+    }
+
+    _enabled.store(false, std::memory_order_release);
+
+    auto path = output_path;
+    output_path = NULL;
+
+    if (!write_trace(path))
+    {
+        g_free(path);
+        return NULL;
+    }
+
+    LOG_INFO(LOG_TRACING, "Trace written to '%s'.", path);
+    return path;
+}
+
+void Tracing::begin(const char *name, const char *arg)
+{
+    record('B', name, 0, arg);
+}
+
+void Tracing::end(const char *name)
+{
+    record('E', name, 0, NULL);
+}
+
+void Tracing::flow_begin(const char *name, uint64_t id)
+{
+    record('s', name, id, NULL);
+}
+
+void Tracing::flow_end(const char *name, uint64_t id)
+{
+    record('f', name, id, NULL);
+}
+
+uint64_t Tracing::next_flow_id()
+{
+    return flow_ids.fetch_add(1, std::memory_order_relaxed);
+}
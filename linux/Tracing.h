@@ -0,0 +1,76 @@
+#pragma once
+#include <glib.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Opt-in tracing of plugin activity in Chrome trace-event format.
+//
+// Enabled by setting FLUTTER_WEBKIT_TRACE to an output path, or at runtime
+// with start_tracing/stop_tracing. Events are recorded into per-thread ring
+// buffers without locking and written out as JSON when tracing stops.
+// Timestamps come from the monotonic clock, like Flutter's own timeline.
+class Tracing
+{
+public:
+    static void init_from_env();
+    static bool start(const gchar *path);
+    static gchar *stop();
+
+    static inline bool enabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    // |name| must be a string literal, |arg| is copied and may be truncated.
+    static void begin(const char *name, const char *arg = NULL);
+    static void end(const char *name);
+    static void flow_begin(const char *name, uint64_t id);
+    static void flow_end(const char *name, uint64_t id);
+
+    static uint64_t next_flow_id();
+
+private:
+    static std::atomic<bool> _enabled;
+};
+
+class TraceScope
+{
+public:
+    TraceScope(const char *name, const char *arg = NULL)
+        : _name(name), _active(Tracing::enabled())
+    {
+        if (this->_active)
+        {
+            Tracing::begin(name, arg);
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (this->_active)
+        {
+            Tracing::end(this->_name);
+        }
+    }
+
+private:
+    const char *_name;
+    bool _active;
+};
+
+#define TRACE_SCOPE(...) TraceScope G_PASTE(_trace_scope_, __LINE__)(__VA_ARGS__)
+
+#define TRACE_FLOW_BEGIN(name, id)          \
+    do                                      \
+    {                                       \
+        if (Tracing::enabled())             \
+            Tracing::flow_begin(name, id);  \
+    } while (0)
+
+#define TRACE_FLOW_END(name, id)            \
+    do                                      \
+    {                                       \
+        if (Tracing::enabled())             \
+            Tracing::flow_end(name, id);    \
+    } while (0)
@@ -0,0 +1,419 @@
+#include "Upload.h"
+#include "Log.h"
+#include "Tracing.h"
+#include "WebView.h"
+
+#include <cstring>
+
+// Fix IntelliSense errors
+#ifndef g_autoptr
+#define g_autoptr(x) x *
+#define g_autofree
+#endif
+
+void Upload::register_scheme(WebKitWebContext *context)
+{
+    // The default context outlives the plugin, register only once.
+    static bool registered = false;
+    if (registered)
+    {
+        return;
+    }
+    registered = true;
+
+    webkit_web_context_register_uri_scheme(
+        context, UPLOAD_SCHEME,
+        +[](WebKitURISchemeRequest *request, gpointer user_data)
+        {
+            auto web_view = webkit_uri_scheme_request_get_web_view(request);
+            auto webview = web_view == NULL ? NULL : (WebView *)g_object_get_data(G_OBJECT(web_view), "flutter-webkit-view");
+            if (webview == NULL)
+            {
+                respond(request, 403, "text/plain", "Uploads are only accepted from plugin webviews.");
+                return;
+            }
+
+            webview->handle_upload(request);
+        },
+        NULL, NULL);
+
+    // Lets pages served over https fetch() the scheme.
+    auto security_manager = webkit_web_context_get_security_manager(context);
+    webkit_security_manager_register_uri_scheme_as_secure(security_manager, UPLOAD_SCHEME);
+    webkit_security_manager_register_uri_scheme_as_cors_enabled(security_manager, UPLOAD_SCHEME);
+}
+
+void Upload::respond(WebKitURISchemeRequest *request, guint status, const gchar *content_type, const gchar *body, const gchar *origin)
+{
+    auto bytes = g_bytes_new(body, strlen(body));
+    auto stream = g_memory_input_stream_new_from_bytes(bytes);
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    auto response = webkit_uri_scheme_response_new(stream, g_bytes_get_size(bytes));
+    webkit_uri_scheme_response_set_status(response, status, NULL);
+    webkit_uri_scheme_response_set_content_type(response, content_type);
+
+    auto headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    soup_message_headers_append(headers, "Vary", "Origin");
+    if (origin != NULL)
+    {
+        soup_message_headers_append(headers, "Access-Control-Allow-Origin", origin);
+        soup_message_headers_append(headers, "Access-Control-Allow-Methods", "POST, PUT");
+        soup_message_headers_append(headers, "Access-Control-Allow-Headers", "*");
+    }
+    webkit_uri_scheme_response_set_http_headers(response, headers);
+
+    webkit_uri_scheme_request_finish_with_response(request, response);
+    g_object_unref(response);
+#else
+    webkit_uri_scheme_request_finish(request, stream, g_bytes_get_size(bytes), content_type);
+#endif
+
+    g_object_unref(stream);
+    g_bytes_unref(bytes);
+}
+
+void Upload::start(WebKitURISchemeRequest *request, FlMethodChannel *channel, uint64_t webview, const std::string &name, const std::string &path, const std::string &origin)
+{
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    // Checked before anything else, a simple POST is sent without a
+    // preflight and must be refused here rather than by CORS.
+    auto headers = webkit_uri_scheme_request_get_http_headers(request);
+    auto request_origin = headers == NULL ? NULL : soup_message_headers_get_one(headers, "Origin");
+    if (g_strcmp0(request_origin, origin.c_str()) != 0)
+    {
+        LOG_WARNING(LOG_UPLOAD, "Upload '%s' from origin '%s' refused, webview #%ld shows '%s'.\n",
+                    name.c_str(), request_origin != NULL ? request_origin : "", webview, origin.c_str());
+        respond(request, 403, "text/plain", "Uploads are only accepted from the page loaded in the webview.");
+        return;
+    }
+
+    auto method = webkit_uri_scheme_request_get_http_method(request);
+    if (g_strcmp0(method, "OPTIONS") == 0)
+    {
+        respond(request, 204, "text/plain", "", origin.c_str());
+        return;
+    }
+
+    if (g_strcmp0(method, "POST") != 0 && g_strcmp0(method, "PUT") != 0)
+    {
+        respond(request, 405, "text/plain", "Only POST and PUT are supported.", origin.c_str());
+        return;
+    }
+
+    // An empty body has no stream, it is uploaded as zero bytes.
+    auto body = webkit_uri_scheme_request_get_http_body(request);
+    if (body == NULL)
+    {
+        body = g_memory_input_stream_new();
+    }
+
+    auto upload = new Upload(request, body, channel, webview, ((WebView *)webview)->events() != nullptr, name, origin);
+    if (path.empty())
+    {
+        upload->start_dart();
+    }
+    else
+    {
+        upload->start_file(path);
+    }
+#else
+    respond(request, 501, "text/plain", "Uploads need WebKitGTK 2.40 or later.");
+#endif
+}
+
+Upload::Upload(WebKitURISchemeRequest *request, GInputStream *body, FlMethodChannel *channel, uint64_t webview, bool background, const std::string &name, const std::string &origin)
+    : _request(WEBKIT_URI_SCHEME_REQUEST(g_object_ref(request))),
+      _body(body),
+      _channel(FL_METHOD_CHANNEL(g_object_ref(channel))),
+      _webview(webview),
+      _background(background),
+      _reply(nullptr),
+      _name(name),
+      _origin(origin),
+      _path(),
+      _size(0)
+{
+}
+
+Upload::~Upload()
+{
+    g_object_unref(this->_body);
+    g_object_unref(this->_channel);
+    g_object_unref(this->_request);
+}
+
+// The view is looked up on every call, an upload can outlive it.
+EventQueue *Upload::events() const
+{
+    auto web_view = webkit_uri_scheme_request_get_web_view(this->_request);
+    auto webview = web_view == NULL ? NULL : (WebView *)g_object_get_data(G_OBJECT(web_view), "flutter-webkit-view");
+    return webview == NULL ? nullptr : webview->events();
+}
+
+// Views owned by a background isolate get their events queued, the root
+// isolate has no handler for them. Once such a view is gone nobody listens.
+void Upload::send(const gchar *method, FlValue *args)
+{
+    if (!this->_background)
+    {
+        fl_method_channel_invoke_method(this->_channel, method, args, NULL, NULL, NULL);
+        return;
+    }
+
+    auto events = this->events();
+    if (events != nullptr)
+    {
+        events->push(method, args);
+    }
+}
+
+// Only one call is in flight at a time, so its |reply| is kept in the upload.
+void Upload::invoke(const gchar *method, FlValue *args, Reply reply)
+{
+    this->_reply = reply;
+
+    if (this->_background)
+    {
+        auto events = this->events();
+        if (events == nullptr)
+        {
+            (this->*reply)(NULL, "Webview was closed.");
+            return;
+        }
+
+        events->request(
+            method, args,
+            +[](FlValue *result, gpointer user_data)
+            {
+                auto self = (Upload *)user_data;
+                (self->*self->_reply)(result, NULL);
+            },
+            this);
+        return;
+    }
+
+    fl_method_channel_invoke_method(
+        this->_channel, method, args, NULL,
+        +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+        {
+            auto self = (Upload *)user_data;
+
+            GError *err = NULL;
+            g_autoptr(FlMethodResponse) response = fl_method_channel_invoke_method_finish(FL_METHOD_CHANNEL(source_object), res, &err);
+            auto value = response == NULL ? NULL : fl_method_response_get_result(response, &err);
+            (self->*self->_reply)(value, err != NULL ? err->message : NULL);
+            g_clear_error(&err);
+        },
+        this);
+}
+
+void Upload::start_dart()
+{
+    const gchar *content_type = NULL;
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    auto headers = webkit_uri_scheme_request_get_http_headers(this->_request);
+    if (headers != NULL)
+    {
+        content_type = soup_message_headers_get_one(headers, "Content-Type");
+    }
+#endif
+
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "webview", fl_value_new_int(this->_webview));
+    fl_value_set_string_take(r, "upload", fl_value_new_int((uint64_t)this));
+    fl_value_set_string_take(r, "name", fl_value_new_string(this->_name.c_str()));
+    fl_value_set_string_take(r, "content_type", content_type == NULL ? fl_value_new_null() : fl_value_new_string(content_type));
+
+    // Nothing is read from the page before Dart has a sink ready.
+    this->invoke("on_upload_started", r, &Upload::started);
+}
+
+void Upload::started(FlValue *result, const gchar *error)
+{
+    if (result == NULL || fl_value_get_type(result) != FL_VALUE_TYPE_BOOL || !fl_value_get_bool(result))
+    {
+        this->fail(error != NULL ? error : "Upload was rejected.");
+        return;
+    }
+
+    this->read_chunk();
+}
+
+void Upload::read_chunk()
+{
+    g_input_stream_read_bytes_async(
+        this->_body, UPLOAD_CHUNK_SIZE, G_PRIORITY_DEFAULT, NULL,
+        +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+        {
+            auto self = (Upload *)user_data;
+
+            GError *err = NULL;
+            auto chunk = g_input_stream_read_bytes_finish(G_INPUT_STREAM(source_object), res, &err);
+            if (chunk == NULL)
+            {
+                self->fail(err->message);
+                g_error_free(err);
+                return;
+            }
+
+            if (g_bytes_get_size(chunk) == 0)
+            {
+                g_bytes_unref(chunk);
+                self->complete_dart();
+                return;
+            }
+
+            self->send_chunk(chunk);
+            g_bytes_unref(chunk);
+        },
+        this);
+}
+
+void Upload::send_chunk(GBytes *chunk)
+{
+    TRACE_SCOPE("upload_chunk", this->_name.c_str());
+
+    gsize length;
+    auto data = (const uint8_t *)g_bytes_get_data(chunk, &length);
+    this->_size += length;
+
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "webview", fl_value_new_int(this->_webview));
+    fl_value_set_string_take(r, "upload", fl_value_new_int((uint64_t)this));
+    fl_value_set_string_take(r, "data", fl_value_new_uint8_list(data, length));
+
+    // The next chunk is read once Dart acknowledged this one.
+    this->invoke("on_upload_chunk", r, &Upload::chunk_sent);
+}
+
+void Upload::chunk_sent(FlValue *result, const gchar *error)
+{
+    if (result == NULL)
+    {
+        this->fail(error != NULL ? error : "Upload sink failed.");
+        return;
+    }
+
+    this->read_chunk();
+}
+
+void Upload::complete_dart()
+{
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "webview", fl_value_new_int(this->_webview));
+    fl_value_set_string_take(r, "upload", fl_value_new_int((uint64_t)this));
+    fl_value_set_string_take(r, "name", fl_value_new_string(this->_name.c_str()));
+    fl_value_set_string_take(r, "size", fl_value_new_int(this->_size));
+
+    // Dart may answer with a JSON body for the page.
+    this->invoke("on_upload_finished", r, &Upload::finished);
+}
+
+void Upload::finished(FlValue *result, const gchar *error)
+{
+    if (result == NULL)
+    {
+        this->fail(error != NULL ? error : "Upload sink failed.");
+        return;
+    }
+
+    if (fl_value_get_type(result) == FL_VALUE_TYPE_STRING)
+    {
+        respond(this->_request, 200, "application/json", fl_value_get_string(result), this->_origin.c_str());
+    }
+    else
+    {
+        g_autofree gchar *body = g_strdup_printf("{\"size\":%" G_GUINT64_FORMAT "}", this->_size);
+        respond(this->_request, 200, "application/json", body, this->_origin.c_str());
+    }
+
+    delete this;
+}
+
+void Upload::start_file(const std::string &path)
+{
+    this->_path = path;
+
+    g_autoptr(GFile) file = g_file_new_for_path(path.c_str());
+
+    // Opening can block on a slow or remote file system, keep it off the
+    // main loop like the splice.
+    g_file_replace_async(
+        file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, G_PRIORITY_DEFAULT, NULL,
+        +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+        {
+            auto self = (Upload *)user_data;
+
+            GError *err = NULL;
+            auto output = g_file_replace_finish(G_FILE(source_object), res, &err);
+            if (output == NULL)
+            {
+                self->fail(err->message);
+                g_error_free(err);
+                return;
+            }
+
+            self->splice(G_OUTPUT_STREAM(output));
+        },
+        this);
+}
+
+void Upload::splice(GOutputStream *output)
+{
+    // Splicing moves the body through a small buffer, a slow disk stalls
+    // reading from the page instead of growing memory.
+    g_output_stream_splice_async(
+        output, this->_body,
+        (GOutputStreamSpliceFlags)(G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+        G_PRIORITY_DEFAULT, NULL,
+        +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+        {
+            auto self = (Upload *)user_data;
+
+            GError *err = NULL;
+            auto size = g_output_stream_splice_finish(G_OUTPUT_STREAM(source_object), res, &err);
+            g_object_unref(source_object);
+            if (size < 0)
+            {
+                self->fail(err->message);
+                g_error_free(err);
+                return;
+            }
+
+            self->_size = size;
+            self->complete_file();
+        },
+        this);
+}
+
+void Upload::complete_file()
+{
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "webview", fl_value_new_int(this->_webview));
+    fl_value_set_string_take(r, "upload", fl_value_new_int((uint64_t)this));
+    fl_value_set_string_take(r, "name", fl_value_new_string(this->_name.c_str()));
+    fl_value_set_string_take(r, "size", fl_value_new_int(this->_size));
+    fl_value_set_string_take(r, "path", fl_value_new_string(this->_path.c_str()));
+    this->send("on_upload_finished", r);
+
+    g_autofree gchar *body = g_strdup_printf("{\"size\":%" G_GUINT64_FORMAT "}", this->_size);
+    respond(this->_request, 200, "application/json", body, this->_origin.c_str());
+
+    delete this;
+}
+
+void Upload::fail(const gchar *message)
+{
+    LOG_WARNING(LOG_UPLOAD, "Upload '%s' in webview #%ld failed: %s\n", this->_name.c_str(), this->_webview, message);
+
+    g_autoptr(FlValue) r = fl_value_new_map();
+    fl_value_set_string_take(r, "webview", fl_value_new_int(this->_webview));
+    fl_value_set_string_take(r, "upload", fl_value_new_int((uint64_t)this));
+    fl_value_set_string_take(r, "message", fl_value_new_string(message));
+    this->send("on_upload_failed", r);
+
+    respond(this->_request, 500, "text/plain", message, this->_origin.c_str());
+
+    delete this;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+#include <webkitgtk-4.1/webkit2/webkit2.h>
+
+#include <string>
+
+#include "EventQueue.h"
+
+// Pages POST to UPLOAD_SCHEME "://upload/<name>" to hand large bodies to the
+// app without going through a JSON message.
+//
+// The scheme is reachable from any frame of a view, so only requests whose
+// Origin is the one of the page loaded in the view are accepted, and only
+// that origin is allowed to read the responses. Frames embedded from other
+// origins can't upload. Pages without an http(s) origin, like local files,
+// have the opaque origin "null", which every such frame shares.
+#define UPLOAD_SCHEME "flutter-webkit"
+
+// Bytes read from the page per chunk.
+#define UPLOAD_CHUNK_SIZE (64 * 1024)
+
+// Streams the body of one upload request, either to Dart one acknowledged
+// chunk at a time or straight into a file, and answers the request once the
+// body is consumed. The page isn't read any faster than the sink accepts the
+// data, so the body is never buffered as a whole. Deletes itself when done.
+class Upload
+{
+public:
+    // Registers the scheme on |context|, requests are routed to the WebView
+    // set as "flutter-webkit-view" data of the requesting WebKitWebView.
+    static void register_scheme(WebKitWebContext *context);
+
+    // An empty |path| streams to Dart. |origin| is the origin of the page
+    // loaded in the view.
+    static void start(WebKitURISchemeRequest *request, FlMethodChannel *channel, uint64_t webview, const std::string &name, const std::string &path, const std::string &origin);
+
+    // Only |origin|, if given, may read the response.
+    static void respond(WebKitURISchemeRequest *request, guint status, const gchar *content_type, const gchar *body, const gchar *origin = NULL);
+
+private:
+    // |result| is NULL if the call failed, |error| may tell why.
+    typedef void (Upload::*Reply)(FlValue *result, const gchar *error);
+
+    Upload(WebKitURISchemeRequest *request, GInputStream *body, FlMethodChannel *channel, uint64_t webview, bool background, const std::string &name, const std::string &origin);
+    ~Upload();
+
+    EventQueue *events() const;
+    void send(const gchar *method, FlValue *args);
+    void invoke(const gchar *method, FlValue *args, Reply reply);
+    void started(FlValue *result, const gchar *error);
+    void chunk_sent(FlValue *result, const gchar *error);
+    void finished(FlValue *result, const gchar *error);
+
+    void start_dart();
+    void start_file(const std::string &path);
+    void splice(GOutputStream *output);
+    void read_chunk();
+    void send_chunk(GBytes *chunk);
+    void complete_dart();
+    void complete_file();
+    void fail(const gchar *message);
+
+    WebKitURISchemeRequest *_request;
+    GInputStream *_body;
+    FlMethodChannel *_channel;
+    uint64_t _webview;
+    bool _background;
+    Reply _reply;
+    std::string _name;
+    std::string _origin;
+    std::string _path;
+    guint64 _size;
+};
@@ -0,0 +1,143 @@
+#include "WarmUp.h"
+
+// Fix IntelliSense errors
+#ifndef g_autoptr
+#define g_autoptr(x) x *
+#define g_autofree
+#endif
+
+WarmUp::WarmUp(size_t rate, gint64 window, gint64 ttl)
+    : _origins(),
+      _recent(),
+      _rate(rate),
+      _window(window),
+      _ttl(ttl),
+      _warmed(0),
+      _preconnected(0),
+      _used(0),
+      _deduplicated(0),
+      _rate_limited(0)
+{
+}
+
+bool WarmUp::origin(const gchar *uri, std::string &origin)
+{
+    auto parsed = g_uri_parse(uri, G_URI_FLAGS_NONE, NULL);
+    if (parsed == NULL)
+    {
+        return false;
+    }
+
+    auto scheme = g_uri_get_scheme(parsed);
+    auto host = g_uri_get_host(parsed);
+    auto ok = host != NULL && host[0] != '\0' &&
+              (g_ascii_strcasecmp(scheme, "http") == 0 || g_ascii_strcasecmp(scheme, "https") == 0);
+
+    if (ok)
+    {
+        g_autofree gchar *lower_scheme = g_ascii_strdown(scheme, -1);
+        g_autofree gchar *lower_host = g_ascii_strdown(host, -1);
+        origin = std::string(lower_scheme) + "://" + lower_host;
+
+        auto port = g_uri_get_port(parsed);
+        if (port > 0)
+        {
+            origin += ":" + std::to_string(port);
+        }
+    }
+
+    g_uri_unref(parsed);
+    return ok;
+}
+
+void WarmUp::expire(gint64 now)
+{
+    while (!this->_recent.empty() && now - this->_recent.front() >= this->_window)
+    {
+        this->_recent.pop_front();
+    }
+
+    for (auto it = this->_origins.begin(); it != this->_origins.end();)
+    {
+        if (now - it->second.time >= this->_ttl)
+        {
+            it = this->_origins.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+WarmUp::Result WarmUp::admit(const gchar *uri, gint64 now, std::string &origin)
+{
+    if (!WarmUp::origin(uri, origin))
+    {
+        return INVALID;
+    }
+
+    this->expire(now);
+
+    if (this->_origins.count(origin) > 0)
+    {
+        this->_deduplicated++;
+        return DEDUPLICATED;
+    }
+
+    if (this->_recent.size() >= this->_rate)
+    {
+        this->_rate_limited++;
+        return RATE_LIMITED;
+    }
+
+    this->_recent.push_back(now);
+    this->_origins[origin] = Entry{.time = now, .used = false};
+    this->_warmed++;
+    return ADMITTED;
+}
+
+void WarmUp::navigated(const gchar *uri, gint64 now)
+{
+    std::string key;
+    if (uri == NULL || !WarmUp::origin(uri, key))
+    {
+        return;
+    }
+
+    this->expire(now);
+
+    // Only the first navigation to a warmed origin benefits from it.
+    auto pos = this->_origins.find(key);
+    if (pos != this->_origins.end() && !pos->second.used)
+    {
+        pos->second.used = true;
+        this->_used++;
+    }
+}
+
+void WarmUp::preconnected(size_t count)
+{
+    this->_preconnected += count;
+}
+
+size_t WarmUp::warmed() const
+{
+    return this->_warmed;
+}
+
+size_t WarmUp::used() const
+{
+    return this->_used;
+}
+
+FlValue *WarmUp::to_fl_value() const
+{
+    auto r = fl_value_new_map();
+    fl_value_set_string_take(r, "warmed", fl_value_new_int(this->_warmed));
+    fl_value_set_string_take(r, "preconnected", fl_value_new_int(this->_preconnected));
+    fl_value_set_string_take(r, "used", fl_value_new_int(this->_used));
+    fl_value_set_string_take(r, "deduplicated", fl_value_new_int(this->_deduplicated));
+    fl_value_set_string_take(r, "rate_limited", fl_value_new_int(this->_rate_limited));
+    return r;
+}
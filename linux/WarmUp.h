@@ -0,0 +1,66 @@
+#pragma once
+#include <flutter_linux/flutter_linux.h>
+
+#include <deque>
+#include <map>
+#include <string>
+
+#define DEFAULT_WARM_UP_RATE 16
+#define DEFAULT_WARM_UP_WINDOW G_TIME_SPAN_SECOND
+#define DEFAULT_WARM_UP_TTL (60 * G_TIME_SPAN_SECOND)
+
+// Bookkeeping for origins warmed up ahead of navigation.
+//
+// An origin is only warmed once per |ttl|, and no more than |rate| origins
+// per |window|. A navigation to a warmed origin within |ttl| counts as a
+// hit. Timestamps are passed in, in microseconds of g_get_monotonic_time().
+class WarmUp
+{
+public:
+    WarmUp(size_t rate, gint64 window, gint64 ttl);
+
+    enum Result
+    {
+        ADMITTED,
+        DEDUPLICATED,
+        RATE_LIMITED,
+        INVALID,
+    };
+
+    // Admitted origins are recorded as warmed and must be warmed up.
+    Result admit(const gchar *uri, gint64 now, std::string &origin);
+    void navigated(const gchar *uri, gint64 now);
+
+    // Admitted origins only get their DNS prefetched until preconnected.
+    void preconnected(size_t count);
+
+    size_t warmed() const;
+    size_t used() const;
+
+    // Map of warmed, preconnected, used, deduplicated and rate_limited
+    // counts.
+    FlValue *to_fl_value() const;
+
+    // "scheme://host[:port]" of http and https URIs.
+    static bool origin(const gchar *uri, std::string &origin);
+
+private:
+    struct Entry
+    {
+        gint64 time;
+        bool used;
+    };
+
+    void expire(gint64 now);
+
+    std::map<std::string, Entry> _origins;
+    std::deque<gint64> _recent;
+    size_t _rate;
+    gint64 _window;
+    gint64 _ttl;
+    size_t _warmed;
+    size_t _preconnected;
+    size_t _used;
+    size_t _deduplicated;
+    size_t _rate_limited;
+};
@@ -1,5 +1,11 @@
 #include "WebView.h"
+#include "BinaryProtocol.h"
+#include "Log.h"
+#include "SettingsTable.h"
+#include "Tracing.h"
+#include "Upload.h"
 #include <JavaScriptCore/JavaScript.h>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,37 +16,215 @@
 #define g_autofree
 #endif
 
+// Property notifications are coalesced and sent at most once per frame.
+#define PROPERTY_FLUSH_INTERVAL_MS 16
+
+#define DEFAULT_PROGRESS_MIN_DELTA 0.02
+#define DEFAULT_PROGRESS_INTERVAL (50 * G_TIME_SPAN_MILLISECOND)
+
+#define DEFAULT_RESOURCE_TIMELINE_CAPACITY 512
+
+#define DEFAULT_VIEWPORT_WIDTH 1280
+#define DEFAULT_VIEWPORT_HEIGHT 720
+
+// Caps requestAnimationFrame callbacks to one per
+// window.__flutterWebkitFrameInterval milliseconds, unset means no cap.
+static const gchar *frame_throttle_script = R"JS(
+(function () {
+    var raf = window.requestAnimationFrame.bind(window);
+    var caf = window.cancelAnimationFrame.bind(window);
+    var ids = new Map();
+    var next = 1;
+    var last = 0;
+    window.requestAnimationFrame = function (callback) {
+        var id = next++;
+        var tick = function (time) {
+            var interval = window.__flutterWebkitFrameInterval || 0;
+            if (interval > 0 && time !== last && time - last < interval) {
+                ids.set(id, raf(tick));
+                return;
+            }
+            ids.delete(id);
+            last = time;
+            callback(time);
+        };
+        ids.set(id, raf(tick));
+        return id;
+    };
+    window.cancelAnimationFrame = function (id) {
+        if (ids.has(id)) {
+            caf(ids.get(id));
+            ids.delete(id);
+        }
+    };
+})();
+)JS";
+
+// |webview| may only be used while |cancellable| isn't cancelled.
 typedef struct
 {
     WebView *webview;
+    GCancellable *cancellable;
     uint64_t id;
+    uint64_t flow;
+    FlBasicMessageChannel *reply_channel;
+    FlBasicMessageChannelResponseHandle *response_handle;
 } js_callback_closure_t;
 
-WebView::WebView(FlValue *args, FlMethodChannel *method_channel, GtkFixed *container)
-    : _container(container),
+// Owned by the resource, may outlive the webview.
+typedef struct
+{
+    std::shared_ptr<ResourceTimeline> timeline;
+    uint32_t generation;
+    int index;
+} resource_closure_t;
+
+typedef struct
+{
+    WebKitPolicyDecision *decision;
+    gchar *uri;
+    NavigationAction fallback_action;
+    uint64_t flow;
+} policy_closure_t;
+
+static void launch_external(const gchar *uri)
+{
+    GError *err = NULL;
+    if (!g_app_info_launch_default_for_uri(uri, NULL, &err))
+    {
+        LOG_WARNING(LOG_WEBVIEW, "Unable to open '%s' externally: %s\n", uri, err->message);
+        g_error_free(err);
+    }
+}
+
+static void apply_navigation_action(WebKitPolicyDecision *decision, const gchar *uri, NavigationAction action);
+
+// Takes ownership of |data|, |value| is the result of the Dart fallback.
+static void complete_policy(policy_closure_t *data, FlValue *value)
+{
+    auto action = data->fallback_action;
+
+    TRACE_SCOPE("decide_policy_completed");
+    TRACE_FLOW_END("decide_policy", data->flow);
+
+    if (value != NULL && fl_value_get_type(value) == FL_VALUE_TYPE_INT &&
+        fl_value_get_int(value) >= NAVIGATION_ACTION_ALLOW &&
+        fl_value_get_int(value) <= NAVIGATION_ACTION_EXTERNAL)
+    {
+        action = (NavigationAction)fl_value_get_int(value);
+    }
+
+    apply_navigation_action(data->decision, data->uri, action);
+
+    g_object_unref(data->decision);
+    g_free(data->uri);
+    delete data;
+}
+
+static void apply_navigation_action(WebKitPolicyDecision *decision, const gchar *uri, NavigationAction action)
+{
+    switch (action)
+    {
+    case NAVIGATION_ACTION_ALLOW:
+        webkit_policy_decision_use(decision);
+        break;
+    case NAVIGATION_ACTION_BLOCK:
+        webkit_policy_decision_ignore(decision);
+        break;
+    case NAVIGATION_ACTION_EXTERNAL:
+        webkit_policy_decision_ignore(decision);
+        launch_external(uri);
+        break;
+    }
+}
+
+WebView::WebView(FlValue *args, FlMethodChannel *method_channel, FlBasicMessageChannel *binary_channel, WebViewHost *host)
+    : _host(host),
+      _offscreen(nullptr),
       _method_channel(method_channel),
-      _callback_states()
+      _binary_channel(binary_channel),
+      _x(0),
+      _y(0),
+      _clipped(false),
+      _clip(),
+      _callback_states(),
+      _navigation_policy(),
+      _default_navigation_action(NAVIGATION_ACTION_ALLOW),
+      _navigation_fallback(false),
+      _property_flush_source(0),
+      _uri_dirty(false),
+      _title_dirty(false),
+      _progress_dirty(false),
+      _sent_uri(NULL),
+      _sent_title(NULL),
+      _sent_load_event(-1),
+      _sent_progress(0.0),
+      _sent_progress_time(0),
+      _progress_min_delta(DEFAULT_PROGRESS_MIN_DELTA),
+      _progress_interval(DEFAULT_PROGRESS_INTERVAL),
+      _prerenders(),
+      _cors_allowlist(NULL),
+      _upload_targets(),
+      _warm_up(nullptr),
+      _events(nullptr),
+      _quality_tier(QUALITY_TIER_FULL),
+      _smooth_scrolling(FALSE),
+      _frame_throttle_installed(false),
+      _frame_interval_script(NULL),
+      _cancellable(g_cancellable_new())
 {
     auto webview = webkit_web_view_new();
     this->_webview = WEBKIT_WEB_VIEW(webview);
 
     auto widget = GTK_WIDGET(webview);
-    gtk_widget_set_size_request(widget, 0, 0);
-    gtk_fixed_put(container, widget, 0, 0);
+    auto settings = webkit_web_view_get_settings(this->_webview);
 
-    gtk_widget_show(widget);
+    if (host != NULL)
+    {
+        gtk_widget_set_size_request(widget, 0, 0);
+        gtk_fixed_put(host->container(), widget, 0, 0);
 
-    auto settings = webkit_web_view_get_settings(this->_webview);
+        gtk_widget_show(widget);
+    }
+    else
+    {
+        // Headless views render into an offscreen window of a fixed logical
+        // size. They never receive input and don't need GPU compositing.
+        auto width = DEFAULT_VIEWPORT_WIDTH;
+        auto height = DEFAULT_VIEWPORT_HEIGHT;
+
+        auto arg_viewport_width = fl_value_lookup_string(args, "viewport_width");
+        auto arg_viewport_height = fl_value_lookup_string(args, "viewport_height");
+        if (arg_viewport_width != NULL && fl_value_get_type(arg_viewport_width) == FL_VALUE_TYPE_INT &&
+            arg_viewport_height != NULL && fl_value_get_type(arg_viewport_height) == FL_VALUE_TYPE_INT)
+        {
+            width = fl_value_get_int(arg_viewport_width);
+            height = fl_value_get_int(arg_viewport_height);
+        }
+
+        webkit_settings_set_hardware_acceleration_policy(settings, WEBKIT_HARDWARE_ACCELERATION_POLICY_NEVER);
+
+        this->_offscreen = gtk_offscreen_window_new();
+        gtk_window_set_default_size(GTK_WINDOW(this->_offscreen), width, height);
+        gtk_widget_set_size_request(widget, width, height);
+        gtk_container_add(GTK_CONTAINER(this->_offscreen), widget);
+        gtk_widget_show_all(this->_offscreen);
+    }
+
+    // Views owned by a background isolate queue their events for it.
+    auto arg_background = fl_value_lookup_string(args, "background");
+    if (arg_background != NULL && fl_value_get_type(arg_background) == FL_VALUE_TYPE_BOOL && fl_value_get_bool(arg_background))
+    {
+        this->_events = new EventQueue(DEFAULT_EVENT_QUEUE_CAPACITY);
+    }
 
     auto arg_cors_allowlist = fl_value_lookup_string(args, "cors_allowlist");
-    auto arg_allow_file_access_from_file_urls = fl_value_lookup_string(args, "allow_file_access_from_file_urls");
-    auto arg_enable_developer_extras = fl_value_lookup_string(args, "enable_developer_extras");
 
     if (arg_cors_allowlist != NULL)
     {
         if (fl_value_get_type(arg_cors_allowlist) != FL_VALUE_TYPE_LIST)
         {
-            g_warning("'cors_allowlist' is ignored as it's not a FL_VALUE_TYPE_LIST.\n");
+            LOG_WARNING(LOG_WEBVIEW, "'cors_allowlist' is ignored as it's not a FL_VALUE_TYPE_LIST.\n");
         }
         else
         {
@@ -53,86 +237,263 @@ WebView::WebView(FlValue *args, FlMethodChannel *method_channel, GtkFixed *conta
                 {
                     auto s = fl_value_get_string(e);
                     arr.push_back(s);
-                    g_message("'%s' is added to 'cors_allowlist'.\n", s);
+                    LOG_DEBUG(LOG_WEBVIEW, "'%s' is added to 'cors_allowlist'.\n", s);
                 }
             }
+            arr.push_back(NULL);
 
             webkit_web_view_set_cors_allowlist(this->_webview, arr.data());
+
+            // Kept for prerendered views, WebKit has no getter for it.
+            this->_cors_allowlist = g_strdupv((gchar **)arr.data());
+        }
+    }
+
+    // History navigation is served from memory unless a preset opts out.
+    webkit_settings_set_enable_page_cache(settings, TRUE);
+
+    auto arg_preset = fl_value_lookup_string(args, "preset");
+    if (arg_preset != NULL)
+    {
+        if (fl_value_get_type(arg_preset) != FL_VALUE_TYPE_STRING)
+        {
+            LOG_WARNING(LOG_WEBVIEW, "'preset' is ignored as it's not a FL_VALUE_TYPE_STRING.\n");
+        }
+        else
+        {
+            settings_apply_preset(settings, fl_value_get_string(arg_preset));
+        }
+    }
+
+    // Settings that used to be passed next to the other arguments.
+    for (auto key : {"allow_file_access_from_file_urls", "enable_developer_extras"})
+    {
+        auto value = fl_value_lookup_string(args, key);
+        if (value != NULL)
+        {
+            settings_apply_value(settings, key, value);
+        }
+    }
+
+    auto arg_settings = fl_value_lookup_string(args, "settings");
+    if (arg_settings != NULL)
+    {
+        if (fl_value_get_type(arg_settings) != FL_VALUE_TYPE_MAP)
+        {
+            LOG_WARNING(LOG_WEBVIEW, "'settings' is ignored as it's not a FL_VALUE_TYPE_MAP.\n");
+        }
+        else
+        {
+            settings_apply_values(settings, arg_settings);
+        }
+    }
+
+    auto arg_progress_min_delta = fl_value_lookup_string(args, "progress_min_delta");
+    if (arg_progress_min_delta != NULL)
+    {
+        if (fl_value_get_type(arg_progress_min_delta) != FL_VALUE_TYPE_FLOAT)
+        {
+            LOG_WARNING(LOG_WEBVIEW, "'progress_min_delta' is ignored as it's not a FL_VALUE_TYPE_FLOAT.\n");
+        }
+        else
+        {
+            this->_progress_min_delta = fl_value_get_float(arg_progress_min_delta);
         }
     }
 
-    if (arg_allow_file_access_from_file_urls != NULL)
+    auto arg_progress_interval = fl_value_lookup_string(args, "progress_interval");
+    if (arg_progress_interval != NULL)
     {
-        if (fl_value_get_type(arg_allow_file_access_from_file_urls) != FL_VALUE_TYPE_BOOL)
+        if (fl_value_get_type(arg_progress_interval) != FL_VALUE_TYPE_INT)
         {
-            g_warning("'allow_file_access_from_file_urls' is ignored as it's not a FL_VALUE_TYPE_BOOL.\n");
+            LOG_WARNING(LOG_WEBVIEW, "'progress_interval' is ignored as it's not a FL_VALUE_TYPE_INT.\n");
         }
         else
         {
-            auto value = fl_value_get_bool(arg_allow_file_access_from_file_urls);
-            webkit_settings_set_allow_file_access_from_file_urls(settings, value);
-            g_message("'allow_file_access_from_file_urls' is set to %s.\n", value ? "true" : "false");
+            this->_progress_interval = fl_value_get_int(arg_progress_interval) * G_TIME_SPAN_MILLISECOND;
         }
     }
 
-    if (arg_enable_developer_extras != NULL)
+    auto resource_timeline_capacity = DEFAULT_RESOURCE_TIMELINE_CAPACITY;
+    auto arg_resource_timeline_capacity = fl_value_lookup_string(args, "resource_timeline_capacity");
+    if (arg_resource_timeline_capacity != NULL)
     {
-        if (fl_value_get_type(arg_enable_developer_extras) != FL_VALUE_TYPE_BOOL)
+        if (fl_value_get_type(arg_resource_timeline_capacity) != FL_VALUE_TYPE_INT)
         {
-            g_warning("'enable_developer_extras' is ignored as it's not a FL_VALUE_TYPE_BOOL.\n");
+            LOG_WARNING(LOG_WEBVIEW, "'resource_timeline_capacity' is ignored as it's not a FL_VALUE_TYPE_INT.\n");
         }
         else
         {
-            auto value = fl_value_get_bool(arg_enable_developer_extras);
-            webkit_settings_set_enable_developer_extras(settings, value);
-            g_message("'enable_developer_extras' is set to %s.\n", value ? "true" : "false");
+            resource_timeline_capacity = fl_value_get_int(arg_resource_timeline_capacity);
         }
     }
 
+    if (resource_timeline_capacity > 0)
+    {
+        this->_resource_timeline = std::make_shared<ResourceTimeline>(resource_timeline_capacity);
+    }
+
+    this->connect_signals();
+}
+
+WebView::~WebView()
+{
+    g_cancellable_cancel(this->_cancellable);
+    g_object_unref(this->_cancellable);
+    this->_cancellable = NULL;
+
+    this->cancel_prerender(NULL);
+    g_signal_handlers_disconnect_by_data(this->_webview, this);
+    // Uploads still running look the view up, it must not be found anymore.
+    g_object_set_data(G_OBJECT(this->_webview), "flutter-webkit-view", NULL);
+
+    if (this->_property_flush_source != 0)
+    {
+        g_source_remove(this->_property_flush_source);
+        this->_property_flush_source = 0;
+    }
+    g_free(this->_sent_uri);
+    g_free(this->_sent_title);
+    g_strfreev(this->_cors_allowlist);
+    if (this->_frame_interval_script != NULL)
+    {
+        webkit_user_script_unref(this->_frame_interval_script);
+    }
+
+    if (this->_host != nullptr)
+    {
+        this->_host->cancel_geometry(this);
+    }
+    gtk_widget_destroy(GTK_WIDGET(this->_webview));
+    if (this->_offscreen != nullptr)
+    {
+        gtk_widget_destroy(this->_offscreen);
+        this->_offscreen = nullptr;
+    }
+    this->_host = nullptr;
+    this->_webview = nullptr;
+    this->_method_channel = nullptr;
+    this->_binary_channel = nullptr;
+
+    // Answers the last poll, which ends the owning isolate's poll loop.
+    delete this->_events;
+    this->_events = nullptr;
+}
+
+// Handlers use the webview as their data, so they can all be dropped at once
+// when a prerendered view is swapped in.
+void WebView::connect_signals()
+{
+    // Lets the upload scheme find the view a request comes from.
+    g_object_set_data(G_OBJECT(this->_webview), "flutter-webkit-view", this);
+
+    if (this->_resource_timeline)
+    {
+        g_signal_connect(
+            this->_webview, "resource-load-started", (GCallback)(+[](WebKitWebView *web_view, WebKitWebResource *resource, WebKitURIRequest *request, gpointer user_data)
+                                                          {
+            auto self = (WebView *)user_data;
+            self->track_resource(resource); }),
+            this);
+    }
+
     g_signal_connect(
-        webview, "load-changed", (GCallback)(+[](WebKitWebView *web_view, WebKitLoadEvent load_event, gpointer user_data)
+        this->_webview, "load-changed", (GCallback)(+[](WebKitWebView *web_view, WebKitLoadEvent load_event, gpointer user_data)
                                              {
             auto self = (WebView *)user_data;
-            auto handle = (uint64_t)self;
-            g_autoptr(FlValue) r = fl_value_new_map();
-            fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
-            fl_value_set_string_take(r, "event", fl_value_new_int(load_event));
-            fl_method_channel_invoke_method(self->_method_channel, "on_load_changed", r, NULL, NULL, NULL); }),
+
+            // Pending property events describe the previous state, send them first.
+            self->flush_properties();
+
+            if (load_event == WEBKIT_LOAD_STARTED)
+            {
+                self->_sent_progress = 0.0;
+
+                if (self->_warm_up != nullptr)
+                {
+                    self->_warm_up->navigated(webkit_web_view_get_uri(web_view), g_get_monotonic_time());
+                }
+
+                if (self->_resource_timeline)
+                {
+                    self->_resource_timeline->reset();
+                }
+            }
+
+            // Every redirect is reported, other repeated events are dropped.
+            if (load_event == self->_sent_load_event && load_event != WEBKIT_LOAD_REDIRECTED)
+            {
+                return;
+            }
+            self->_sent_load_event = load_event;
+            self->send_load_event(load_event); }),
         this);
 
     g_signal_connect(
-        webview, "notify::uri", (GCallback)(+[](WebKitWebView *web_view, GParamSpec *property, gpointer user_data)
+        this->_webview, "notify::uri", (GCallback)(+[](WebKitWebView *web_view, GParamSpec *property, gpointer user_data)
                                             {
         auto self = (WebView *)user_data;
-        auto handle = (uint64_t)self;
-
-        auto uri = webkit_web_view_get_uri(web_view);
-        g_autoptr(FlValue) r = fl_value_new_map();
-        fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
-        fl_value_set_string_take(r, "uri", uri == NULL ? fl_value_new_null() : fl_value_new_string(uri));
-        fl_method_channel_invoke_method(self->_method_channel, "on_uri_changed", r, NULL, NULL, NULL); }),
+        self->_uri_dirty = true;
+        self->schedule_property_flush(); }),
         this);
 
     g_signal_connect(
-        webview, "notify::title", (GCallback)(+[](WebKitWebView *web_view, GParamSpec *property, gpointer user_data)
+        this->_webview, "notify::title", (GCallback)(+[](WebKitWebView *web_view, GParamSpec *property, gpointer user_data)
                                               {
         auto self = (WebView *)user_data;
-        auto handle = (uint64_t)self;
+        self->_title_dirty = true;
+        self->schedule_property_flush(); }),
+        this);
+
+    g_signal_connect(
+        this->_webview, "notify::estimated-load-progress", (GCallback)(+[](WebKitWebView *web_view, GParamSpec *property, gpointer user_data)
+                                                                {
+        auto self = (WebView *)user_data;
+        self->_progress_dirty = true;
+        self->schedule_property_flush(); }),
+        this);
 
-        auto title = webkit_web_view_get_title(web_view);
-        g_autoptr(FlValue) r = fl_value_new_map();
-        fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
-        fl_value_set_string_take(r, "title", title == NULL ? fl_value_new_null() : fl_value_new_string(title));
-        fl_method_channel_invoke_method(self->_method_channel, "on_title_changed", r, NULL, NULL, NULL); }),
+    g_signal_connect(
+        this->_webview, "decide-policy", (GCallback)(+[](WebKitWebView *web_view, WebKitPolicyDecision *decision, WebKitPolicyDecisionType type, gpointer user_data) -> gboolean
+                                              {
+        auto self = (WebView *)user_data;
+        TRACE_SCOPE("decide_policy");
+        return self->decide_policy(decision, type); }),
         this);
 }
 
-WebView::~WebView()
+WebViewHost *WebView::host() const
 {
-    gtk_widget_destroy(GTK_WIDGET(this->_webview));
-    this->_container = nullptr;
-    this->_webview = nullptr;
-    this->_method_channel = nullptr;
+    return this->_host;
+}
+
+FlMethodChannel *WebView::channel() const
+{
+    return this->_method_channel;
+}
+
+bool WebView::headless() const
+{
+    return this->_offscreen != nullptr;
+}
+
+void WebView::reparent(WebViewHost *host)
+{
+    if (host == this->_host || this->headless())
+    {
+        return;
+    }
+
+    // Keep the widget alive while it's out of any container, so the page
+    // survives the move without reloading.
+    auto widget = GTK_WIDGET(this->_webview);
+    g_object_ref(widget);
+    gtk_container_remove(GTK_CONTAINER(this->_host->container()), widget);
+    gtk_fixed_put(host->container(), widget, this->_x, this->_y);
+    g_object_unref(widget);
+
+    this->_host->cancel_geometry(this);
+    this->_host = host;
 }
 
 void WebView::resize(int width, int height)
@@ -142,63 +503,162 @@ void WebView::resize(int width, int height)
 
 void WebView::move(int x, int y)
 {
-    gtk_fixed_move(this->_container, GTK_WIDGET(this->_webview), x, y);
+    this->_x = x;
+    this->_y = y;
+    gtk_fixed_move(this->_host->container(), GTK_WIDGET(this->_webview), x, y);
+}
+
+void WebView::set_clip(const GdkRectangle *clip)
+{
+    if (clip == NULL && !this->_clipped)
+    {
+        return;
+    }
+
+    // Reshaping the window is not free, skip it when nothing changed.
+    if (clip != NULL && this->_clipped &&
+        clip->x == this->_clip.x && clip->y == this->_clip.y &&
+        clip->width == this->_clip.width && clip->height == this->_clip.height)
+    {
+        return;
+    }
+
+    auto widget = GTK_WIDGET(this->_webview);
+
+    if (clip == NULL)
+    {
+        this->_clipped = false;
+        gtk_widget_shape_combine_region(widget, NULL);
+        gtk_widget_input_shape_combine_region(widget, NULL);
+        gtk_widget_set_child_visible(widget, TRUE);
+        return;
+    }
+
+    this->_clipped = true;
+    this->_clip = *clip;
+
+    // Fully clipped views are unmapped, WebKit then treats the page as
+    // hidden and stops painting it altogether.
+    if (clip->width <= 0 || clip->height <= 0)
+    {
+        gtk_widget_set_child_visible(widget, FALSE);
+        return;
+    }
+
+    gtk_widget_set_child_visible(widget, TRUE);
+
+    cairo_rectangle_int_t rect = {clip->x, clip->y, clip->width, clip->height};
+    auto region = cairo_region_create_rectangle(&rect);
+    gtk_widget_shape_combine_region(widget, region);
+    gtk_widget_input_shape_combine_region(widget, region);
+    cairo_region_destroy(region);
 }
 
 void WebView::load_uri(const gchar *uri)
 {
+    // A prerendered page is shown right away instead of being loaded again.
+    if (this->swap_prerender(uri))
+    {
+        return;
+    }
+
     webkit_web_view_load_uri(this->_webview, uri);
 }
 
-void WebView::evaluate_javascript(uint64_t id, const gchar *script)
+// The result is the answer to |response_handle| if given, so it goes back to
+// the isolate that asked for it, and an event otherwise.
+void WebView::evaluate_javascript(uint64_t id, const gchar *script,
+                                  FlBasicMessageChannel *reply_channel,
+                                  FlBasicMessageChannelResponseHandle *response_handle)
 {
     auto data = new js_callback_closure_t();
     data->id = id;
     data->webview = this;
+    data->cancellable = G_CANCELLABLE(g_object_ref(this->_cancellable));
+    data->flow = Tracing::next_flow_id();
+    data->reply_channel = response_handle == NULL ? NULL : FL_BASIC_MESSAGE_CHANNEL(g_object_ref(reply_channel));
+    data->response_handle = response_handle == NULL ? NULL : FL_BASIC_MESSAGE_CHANNEL_RESPONSE_HANDLE(g_object_ref(response_handle));
+
+    TRACE_FLOW_BEGIN("evaluate_javascript", data->flow);
 
     webkit_web_view_run_javascript(
         this->_webview,
         script,
-        NULL,
+        this->_cancellable,
         +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
         {
             auto data = (js_callback_closure_t *)user_data;
             auto self = data->webview;
             auto handle = (uint64_t)self;
             auto id = data->id;
+            g_autoptr(GCancellable) cancellable = data->cancellable;
+            g_autoptr(FlBasicMessageChannel) reply_channel = data->reply_channel;
+            g_autoptr(FlBasicMessageChannelResponseHandle) response_handle = data->response_handle;
+
+            TRACE_SCOPE("evaluate_javascript_completed");
+            TRACE_FLOW_END("evaluate_javascript", data->flow);
 
             delete data;
 
-            if (self->_webview == NULL)
+            // The view is gone, |self| must not be touched.
+            if (g_cancellable_is_cancelled(cancellable))
             {
+                if (response_handle != NULL)
+                {
+                    fl_basic_message_channel_respond(reply_channel, response_handle, NULL, NULL);
+                }
                 return;
             }
 
+            // The source may be a view that was since replaced by a prerender.
             GError *err = NULL;
-            auto js_result = webkit_web_view_run_javascript_finish(self->_webview, res, &err);
+            auto js_result = webkit_web_view_run_javascript_finish(WEBKIT_WEB_VIEW(source_object), res, &err);
 
-            g_autoptr(FlValue) r = fl_value_new_map();
-            fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
-            fl_value_set_string_take(r, "id", fl_value_new_int(id));
+            // The JSON is carried as raw bytes, an empty payload means null.
+            BinaryWriter w(BINARY_EVENT_JAVASCRIPT_RESULT);
+            w.u64(handle);
+            w.u64(id);
             if (!err)
             {
                 auto val = webkit_javascript_result_get_js_value(js_result);
-                auto json = jsc_value_to_json(val, 0);
+                gchar *json;
+                {
+                    TRACE_SCOPE("jsc_value_to_json");
+                    json = jsc_value_to_json(val, 0);
+                }
 
-                fl_value_set_string_take(r, "error", fl_value_new_int(0));
-                fl_value_set_string_take(r, "message", fl_value_new_null());
-                fl_value_set_string_take(r, "data", json == NULL ? fl_value_new_null() : fl_value_new_string(json));
+                w.i32(0);
+                w.u32(0);
+                if (json != NULL)
+                {
+                    w.bytes(json, strlen(json));
+                }
 
                 g_free(json);
+                webkit_javascript_result_unref(js_result);
             }
             else
             {
-                fl_value_set_string_take(r, "error", fl_value_new_int(err->code));
-                fl_value_set_string_take(r, "message", err->message == NULL ? fl_value_new_null() : fl_value_new_string(err->message));
-                fl_value_set_string_take(r, "data", fl_value_new_null());
+                auto message = err->message == NULL ? "" : err->message;
+                w.i32(err->code);
+                w.u32(strlen(message));
+                w.bytes(message, strlen(message));
+                g_error_free(err);
             }
 
-            fl_method_channel_invoke_method(self->_method_channel, "on_evaluate_javascript_completed", r, NULL, NULL, NULL);
+            g_autoptr(FlValue) message = w.finish();
+            if (response_handle != NULL)
+            {
+                g_autoptr(GError) respond_err = NULL;
+                if (!fl_basic_message_channel_respond(reply_channel, response_handle, message, &respond_err))
+                {
+                    LOG_WARNING(LOG_WEBVIEW, "Unable to reply with javascript result: %s\n", respond_err->message);
+                }
+            }
+            else
+            {
+                self->send_binary(message);
+            }
         },
         data);
 }
@@ -215,12 +675,88 @@ void WebView::reload(bool bypass_cache)
     }
 }
 
+bool WebView::go_back()
+{
+    if (!webkit_web_view_can_go_back(this->_webview))
+    {
+        return false;
+    }
+
+    webkit_web_view_go_back(this->_webview);
+    return true;
+}
+
+bool WebView::go_forward()
+{
+    if (!webkit_web_view_can_go_forward(this->_webview))
+    {
+        return false;
+    }
+
+    webkit_web_view_go_forward(this->_webview);
+    return true;
+}
+
+// |index| counts from the oldest item, like the list returned by
+// get_back_forward_list.
+bool WebView::go_to_index(int index)
+{
+    auto list = webkit_web_view_get_back_forward_list(this->_webview);
+    auto back = webkit_back_forward_list_get_back_list(list);
+    int current = g_list_length(back);
+    g_list_free(back);
+
+    auto item = webkit_back_forward_list_get_nth_item(list, index - current);
+    if (item == NULL)
+    {
+        return false;
+    }
+
+    if (index != current)
+    {
+        webkit_web_view_go_to_back_forward_list_item(this->_webview, item);
+    }
+    return true;
+}
+
+FlValue *WebView::get_back_forward_list()
+{
+    auto list = webkit_web_view_get_back_forward_list(this->_webview);
+    auto back = webkit_back_forward_list_get_back_list(list);
+    auto forward = webkit_back_forward_list_get_forward_list(list);
+    int back_length = g_list_length(back);
+    int forward_length = g_list_length(forward);
+    g_list_free(back);
+    g_list_free(forward);
+
+    auto items = fl_value_new_list();
+    for (int offset = -back_length; offset <= forward_length; offset++)
+    {
+        auto item = webkit_back_forward_list_get_nth_item(list, offset);
+        if (item == NULL)
+        {
+            continue;
+        }
+
+        auto title = webkit_back_forward_list_item_get_title(item);
+        auto value = fl_value_new_map();
+        fl_value_set_string_take(value, "uri", fl_value_new_string(webkit_back_forward_list_item_get_uri(item)));
+        fl_value_set_string_take(value, "title", title == NULL ? fl_value_new_null() : fl_value_new_string(title));
+        fl_value_append_take(items, value);
+    }
+
+    auto result = fl_value_new_map();
+    fl_value_set_string_take(result, "items", items);
+    fl_value_set_string_take(result, "current", fl_value_new_int(fl_value_get_length(items) == 0 ? -1 : back_length));
+    return result;
+}
+
 bool WebView::register_javascript_callback(const gchar *name)
 {
     std::string cb_name(name);
     if (this->_callback_states.count(cb_name) > 0)
     {
-        g_warning("Javascript callback '%s' is already register in webview #%ld.", name, (uint64_t)this);
+        LOG_WARNING(LOG_WEBVIEW, "Javascript callback '%s' is already register in webview #%ld.", name, (uint64_t)this);
         return false;
     }
 
@@ -243,8 +779,14 @@ bool WebView::register_javascript_callback(const gchar *name)
             auto self = state->webview;
             auto handle = (uint64_t)self;
 
+            TRACE_SCOPE("javascript_callback", state->name.c_str());
+
             auto value = webkit_javascript_result_get_js_value(res);
-            auto json = jsc_value_to_json(value, 0);
+            gchar *json;
+            {
+                TRACE_SCOPE("jsc_value_to_json");
+                json = jsc_value_to_json(value, 0);
+            }
 
             g_autoptr(FlValue) r = fl_value_new_map();
             fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
@@ -252,7 +794,7 @@ bool WebView::register_javascript_callback(const gchar *name)
             fl_value_set_string_take(r, "data", json == NULL ? fl_value_new_null() : fl_value_new_string(json));
             g_free(json);
 
-            fl_method_channel_invoke_method(self->_method_channel, "on_javascript_callback", r, NULL, NULL, NULL); }),
+            self->send_event("on_javascript_callback", r); }),
         &this->_callback_states[cb_name]);
 
     this->_callback_states[cb_name].handler_id = handler_id;
@@ -265,7 +807,7 @@ bool WebView::register_javascript_callback(const gchar *name)
     }
     else
     {
-        g_message("Registered callback '%s' in webview #%ld.", name, (uint64_t)this);
+        LOG_DEBUG(LOG_WEBVIEW, "Registered callback '%s' in webview #%ld.", name, (uint64_t)this);
     }
 
     return ok;
@@ -276,7 +818,7 @@ void WebView::unregister_javascript_callback(const gchar *name)
     std::string cb_name(name);
     if (this->_callback_states.count(cb_name) == 0)
     {
-        g_warning("Unable to unregister callback '%s' from webview #%ld as it's not registered.", name, (uint64_t)this);
+        LOG_WARNING(LOG_WEBVIEW, "Unable to unregister callback '%s' from webview #%ld as it's not registered.", name, (uint64_t)this);
         return;
     }
 
@@ -286,11 +828,783 @@ void WebView::unregister_javascript_callback(const gchar *name)
     g_signal_handler_disconnect(manager, this->_callback_states[cb_name].handler_id);
     this->_callback_states.erase(cb_name);
 
-    g_message("Unregistered callback '%s' from webview #%ld.", name, (uint64_t)this);
+    LOG_DEBUG(LOG_WEBVIEW, "Unregistered callback '%s' from webview #%ld.", name, (uint64_t)this);
 }
 
 void WebView::open_inspector()
 {
     WebKitWebInspector *inspector = webkit_web_view_get_inspector(this->_webview);
     webkit_web_inspector_show(WEBKIT_WEB_INSPECTOR(inspector));
-}
\ No newline at end of file
+}
+
+void WebView::set_navigation_policy(FlValue *rules, NavigationAction default_action, bool fallback)
+{
+    this->_navigation_policy.compile(rules);
+    this->_default_navigation_action = default_action;
+    this->_navigation_fallback = fallback;
+}
+
+bool WebView::decide_policy(WebKitPolicyDecision *decision, WebKitPolicyDecisionType type)
+{
+    WebKitURIRequest *request = NULL;
+    switch (type)
+    {
+    case WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION:
+    case WEBKIT_POLICY_DECISION_TYPE_NEW_WINDOW_ACTION:
+    {
+        auto navigation_action = webkit_navigation_policy_decision_get_navigation_action(WEBKIT_NAVIGATION_POLICY_DECISION(decision));
+        request = webkit_navigation_action_get_request(navigation_action);
+        break;
+    }
+    case WEBKIT_POLICY_DECISION_TYPE_RESPONSE:
+        request = webkit_response_policy_decision_get_request(WEBKIT_RESPONSE_POLICY_DECISION(decision));
+        break;
+    default:
+        return false;
+    }
+
+    auto uri = webkit_uri_request_get_uri(request);
+    if (uri == NULL)
+    {
+        return false;
+    }
+
+    NavigationAction action;
+    if (!this->_navigation_policy.evaluate(uri, &action))
+    {
+        // Unmatched responses are left to WebKit, so unsupported MIME types still become downloads.
+        if (type == WEBKIT_POLICY_DECISION_TYPE_RESPONSE)
+        {
+            return false;
+        }
+
+        if (!this->_navigation_fallback)
+        {
+            action = this->_default_navigation_action;
+        }
+        else
+        {
+            auto handle = (uint64_t)this;
+            auto data = new policy_closure_t();
+            data->decision = WEBKIT_POLICY_DECISION(g_object_ref(decision));
+            data->uri = g_strdup(uri);
+            data->fallback_action = this->_default_navigation_action;
+            data->flow = Tracing::next_flow_id();
+
+            TRACE_FLOW_BEGIN("decide_policy", data->flow);
+
+            g_autoptr(FlValue) r = fl_value_new_map();
+            fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
+            fl_value_set_string_take(r, "uri", fl_value_new_string(uri));
+            fl_value_set_string_take(r, "new_window", fl_value_new_bool(type == WEBKIT_POLICY_DECISION_TYPE_NEW_WINDOW_ACTION));
+
+            if (this->_events != nullptr)
+            {
+                this->_events->request(
+                    "on_decide_policy", r,
+                    +[](FlValue *result, gpointer user_data)
+                    {
+                        complete_policy((policy_closure_t *)user_data, result);
+                    },
+                    data);
+                return true;
+            }
+
+            fl_method_channel_invoke_method(
+                this->_method_channel, "on_decide_policy", r, NULL,
+                +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+                {
+                    auto data = (policy_closure_t *)user_data;
+
+                    FlValue *value = NULL;
+                    GError *err = NULL;
+                    g_autoptr(FlMethodResponse) response = fl_method_channel_invoke_method_finish(FL_METHOD_CHANNEL(source_object), res, &err);
+                    if (response != NULL)
+                    {
+                        value = fl_method_response_get_result(response, &err);
+                    }
+
+                    if (err != NULL)
+                    {
+                        LOG_WARNING(LOG_WEBVIEW, "Navigation policy fallback failed for '%s': %s\n", data->uri, err->message);
+                        g_error_free(err);
+                    }
+
+                    complete_policy(data, value);
+                },
+                data);
+
+            return true;
+        }
+    }
+
+    // Allowed decisions keep WebKit's default handling.
+    if (action == NAVIGATION_ACTION_ALLOW)
+    {
+        return false;
+    }
+
+    apply_navigation_action(decision, uri, action);
+    return true;
+}
+
+void WebView::schedule_property_flush()
+{
+    if (this->_property_flush_source != 0)
+    {
+        return;
+    }
+
+    this->_property_flush_source = g_timeout_add(
+        PROPERTY_FLUSH_INTERVAL_MS,
+        +[](gpointer user_data) -> gboolean
+        {
+            auto self = (WebView *)user_data;
+            self->_property_flush_source = 0;
+            self->flush_properties();
+            return G_SOURCE_REMOVE;
+        },
+        this);
+}
+
+void WebView::flush_properties()
+{
+    auto handle = (uint64_t)this;
+
+    if (this->_uri_dirty)
+    {
+        this->_uri_dirty = false;
+
+        auto uri = webkit_web_view_get_uri(this->_webview);
+        if (g_strcmp0(uri, this->_sent_uri) != 0)
+        {
+            g_free(this->_sent_uri);
+            this->_sent_uri = g_strdup(uri);
+
+            g_autoptr(FlValue) r = fl_value_new_map();
+            fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
+            fl_value_set_string_take(r, "uri", uri == NULL ? fl_value_new_null() : fl_value_new_string(uri));
+            this->send_event("on_uri_changed", r);
+        }
+    }
+
+    if (this->_title_dirty)
+    {
+        this->_title_dirty = false;
+
+        auto title = webkit_web_view_get_title(this->_webview);
+        if (g_strcmp0(title, this->_sent_title) != 0)
+        {
+            g_free(this->_sent_title);
+            this->_sent_title = g_strdup(title);
+
+            g_autoptr(FlValue) r = fl_value_new_map();
+            fl_value_set_string_take(r, "webview", fl_value_new_int(handle));
+            fl_value_set_string_take(r, "title", title == NULL ? fl_value_new_null() : fl_value_new_string(title));
+            this->send_event("on_title_changed", r);
+        }
+    }
+
+    if (this->_progress_dirty)
+    {
+        this->flush_progress();
+
+        // Held back by the progress interval, try again on a later frame.
+        if (this->_progress_dirty)
+        {
+            this->schedule_property_flush();
+        }
+    }
+}
+
+void WebView::flush_progress()
+{
+    auto progress = webkit_web_view_get_estimated_load_progress(this->_webview);
+    auto now = g_get_monotonic_time();
+
+    // Completion and the start of a new load are always reported.
+    auto complete = progress >= 1.0 && this->_sent_progress < 1.0;
+    auto restarted = progress < this->_sent_progress;
+    if (!complete && !restarted)
+    {
+        if (progress - this->_sent_progress < this->_progress_min_delta)
+        {
+            this->_progress_dirty = false;
+            return;
+        }
+
+        if (now - this->_sent_progress_time < this->_progress_interval)
+        {
+            return;
+        }
+    }
+
+    this->_progress_dirty = false;
+    this->_sent_progress = progress;
+    this->_sent_progress_time = now;
+
+    BinaryWriter w(BINARY_EVENT_LOAD_PROGRESS);
+    w.u64((uint64_t)this);
+    w.f64(progress);
+    g_autoptr(FlValue) message = w.finish();
+    this->send_binary(message);
+}
+
+void WebView::send_event(const gchar *method, FlValue *args)
+{
+    TRACE_SCOPE("send_event", method);
+    if (this->_events != nullptr)
+    {
+        this->_events->push(method, args);
+        return;
+    }
+    fl_method_channel_invoke_method(this->_method_channel, method, args, NULL, NULL, NULL);
+}
+
+void WebView::send_binary(FlValue *message)
+{
+    TRACE_SCOPE("send_binary");
+    if (this->_events != nullptr)
+    {
+        this->_events->push_binary(message);
+        return;
+    }
+    fl_basic_message_channel_send(this->_binary_channel, message, NULL, NULL, NULL);
+}
+
+void WebView::send_load_event(WebKitLoadEvent load_event)
+{
+    BinaryWriter w(BINARY_EVENT_LOAD_CHANGED);
+    w.u64((uint64_t)this);
+    w.u8(load_event);
+    g_autoptr(FlValue) message = w.finish();
+    this->send_binary(message);
+}
+
+FlValue *WebView::get_resource_timeline()
+{
+    if (!this->_resource_timeline)
+    {
+        return fl_value_new_null();
+    }
+
+    return this->_resource_timeline->to_fl_value();
+}
+
+void WebView::track_resource(WebKitWebResource *resource)
+{
+    auto index = this->_resource_timeline->add(webkit_web_resource_get_uri(resource));
+    if (index < 0)
+    {
+        return;
+    }
+
+    auto data = new resource_closure_t{
+        .timeline = this->_resource_timeline,
+        .generation = this->_resource_timeline->generation(),
+        .index = index};
+    g_object_set_data_full(G_OBJECT(resource), "flutter-webkit-resource", data, +[](gpointer p)
+                           { delete (resource_closure_t *)p; });
+
+    g_signal_connect(
+        resource, "notify::response", (GCallback)(+[](WebKitWebResource *resource, GParamSpec *property, gpointer user_data)
+                                                  {
+        auto data = (resource_closure_t *)user_data;
+        data->timeline->set_response(data->generation, data->index, webkit_web_resource_get_response(resource)); }),
+        data);
+
+    g_signal_connect(
+        resource, "received-data", (GCallback)(+[](WebKitWebResource *resource, guint64 data_length, gpointer user_data)
+                                               {
+        auto data = (resource_closure_t *)user_data;
+        data->timeline->add_data(data->generation, data->index, data_length); }),
+        data);
+
+    g_signal_connect(
+        resource, "finished", (GCallback)(+[](WebKitWebResource *resource, gpointer user_data)
+                                          {
+        auto data = (resource_closure_t *)user_data;
+        data->timeline->finish(data->generation, data->index); }),
+        data);
+
+    g_signal_connect(
+        resource, "failed", (GCallback)(+[](WebKitWebResource *resource, GError *error, gpointer user_data)
+                                        {
+        auto data = (resource_closure_t *)user_data;
+        data->timeline->fail(data->generation, data->index, error == NULL ? NULL : error->message); }),
+        data);
+}
+
+bool WebView::update_settings(const gchar *preset, FlValue *values)
+{
+    auto settings = webkit_web_view_get_settings(this->_webview);
+
+    auto ok = true;
+    if (preset != NULL)
+    {
+        ok = settings_apply_preset(settings, preset);
+    }
+
+    if (values != NULL)
+    {
+        ok = settings_apply_values(settings, values) == 0 && ok;
+    }
+
+    return ok;
+}
+
+void WebView::snapshot(bool full_document, FlMethodCall *method_call)
+{
+    webkit_web_view_get_snapshot(
+        this->_webview,
+        full_document ? WEBKIT_SNAPSHOT_REGION_FULL_DOCUMENT : WEBKIT_SNAPSHOT_REGION_VISIBLE,
+        WEBKIT_SNAPSHOT_OPTIONS_NONE,
+        NULL,
+        +[](GObject *source_object, GAsyncResult *res, gpointer user_data)
+        {
+            g_autoptr(FlMethodCall) method_call = FL_METHOD_CALL(user_data);
+            TRACE_SCOPE("snapshot_completed");
+
+            GError *err = NULL;
+            auto surface = webkit_web_view_get_snapshot_finish(WEBKIT_WEB_VIEW(source_object), res, &err);
+            if (surface == NULL)
+            {
+                fl_method_call_respond_error(method_call, "snapshot_failed", err->message, NULL, NULL);
+                g_error_free(err);
+                return;
+            }
+
+            auto png = g_byte_array_new();
+            cairo_surface_write_to_png_stream(
+                surface,
+                +[](void *closure, const unsigned char *data, unsigned int length) -> cairo_status_t
+                {
+                    g_byte_array_append((GByteArray *)closure, data, length);
+                    return CAIRO_STATUS_SUCCESS;
+                },
+                png);
+            cairo_surface_destroy(surface);
+
+            g_autoptr(FlValue) result = fl_value_new_uint8_list(png->data, png->len);
+            g_byte_array_unref(png);
+            fl_method_call_respond_success(method_call, result, NULL);
+        },
+        g_object_ref(method_call));
+}
+
+bool WebView::prerender(const gchar *uri)
+{
+    for (auto &p : this->_prerenders)
+    {
+        if (p.uri == uri)
+        {
+            p.last_used = g_get_monotonic_time();
+            return !p.failed;
+        }
+    }
+
+    if (g_strcmp0(webkit_web_view_get_uri(this->_webview), uri) == 0)
+    {
+        return false;
+    }
+
+    TRACE_SCOPE("prerender");
+
+    // Related views share the web process, settings and user content
+    // manager, so registered callbacks keep working after the swap.
+    auto webview = WEBKIT_WEB_VIEW(webkit_web_view_new_with_related_view(this->_webview));
+    auto widget = GTK_WIDGET(webview);
+
+    if (this->_cors_allowlist != NULL)
+    {
+        webkit_web_view_set_cors_allowlist(webview, (const gchar *const *)this->_cors_allowlist);
+    }
+
+    // Laid out at the current size, so the page doesn't reflow when shown.
+    int width, height;
+    gtk_widget_get_size_request(GTK_WIDGET(this->_webview), &width, &height);
+    if (width <= 0 || height <= 0)
+    {
+        width = DEFAULT_VIEWPORT_WIDTH;
+        height = DEFAULT_VIEWPORT_HEIGHT;
+    }
+
+    auto window = gtk_offscreen_window_new();
+    gtk_window_set_default_size(GTK_WINDOW(window), width, height);
+    gtk_widget_set_size_request(widget, width, height);
+    gtk_container_add(GTK_CONTAINER(window), widget);
+    gtk_widget_show_all(window);
+
+    // Nothing that needs Dart, another window or a download happens
+    // speculatively, such a prerender is dropped instead.
+    g_signal_connect(
+        webview, "decide-policy", (GCallback)(+[](WebKitWebView *web_view, WebKitPolicyDecision *decision, WebKitPolicyDecisionType type, gpointer user_data) -> gboolean
+                                              {
+        auto self = (WebView *)user_data;
+        auto allowed = true;
+
+        if (type == WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION)
+        {
+            auto navigation_action = webkit_navigation_policy_decision_get_navigation_action(WEBKIT_NAVIGATION_POLICY_DECISION(decision));
+            auto uri = webkit_uri_request_get_uri(webkit_navigation_action_get_request(navigation_action));
+
+            NavigationAction action = self->_default_navigation_action;
+            if (uri != NULL && !self->_navigation_policy.evaluate(uri, &action) && self->_navigation_fallback)
+            {
+                allowed = false;
+            }
+            else
+            {
+                allowed = action == NAVIGATION_ACTION_ALLOW;
+            }
+        }
+        else if (type == WEBKIT_POLICY_DECISION_TYPE_RESPONSE)
+        {
+            allowed = webkit_response_policy_decision_is_mime_type_supported(WEBKIT_RESPONSE_POLICY_DECISION(decision));
+        }
+        else
+        {
+            webkit_policy_decision_ignore(decision);
+            return TRUE;
+        }
+
+        if (allowed)
+        {
+            return FALSE;
+        }
+
+        for (auto &p : self->_prerenders)
+        {
+            if (p.webview == web_view)
+            {
+                p.failed = true;
+            }
+        }
+        webkit_policy_decision_ignore(decision);
+        return TRUE; }),
+        this);
+
+    g_signal_connect(
+        webview, "load-failed", (GCallback)(+[](WebKitWebView *web_view, WebKitLoadEvent load_event, gchar *failing_uri, GError *error, gpointer user_data) -> gboolean
+                                            {
+        auto self = (WebView *)user_data;
+        for (auto &p : self->_prerenders)
+        {
+            if (p.webview == web_view)
+            {
+                p.failed = true;
+            }
+        }
+        return FALSE; }),
+        this);
+
+    this->_prerenders.push_back(Prerender{
+        .uri = uri,
+        .webview = webview,
+        .window = window,
+        .last_used = g_get_monotonic_time(),
+        .failed = false});
+
+    webkit_web_view_load_uri(webview, uri);
+    LOG_INFO(LOG_WEBVIEW, "Prerendering '%s' in webview #%ld.", uri, (uint64_t)this);
+    return true;
+}
+
+void WebView::cancel_prerender(const gchar *uri)
+{
+    for (auto i = this->_prerenders.size(); i > 0; i--)
+    {
+        if (uri == NULL || this->_prerenders[i - 1].uri == uri)
+        {
+            this->destroy_prerender(i - 1);
+        }
+    }
+}
+
+size_t WebView::prerender_count() const
+{
+    return this->_prerenders.size();
+}
+
+gint64 WebView::oldest_prerender() const
+{
+    gint64 oldest = -1;
+    for (auto &p : this->_prerenders)
+    {
+        if (oldest < 0 || p.last_used < oldest)
+        {
+            oldest = p.last_used;
+        }
+    }
+
+    return oldest;
+}
+
+void WebView::evict_oldest_prerender()
+{
+    auto oldest = this->oldest_prerender();
+    for (size_t i = 0; i < this->_prerenders.size(); i++)
+    {
+        if (this->_prerenders[i].last_used == oldest)
+        {
+            LOG_INFO(LOG_WEBVIEW, "Evicted prerender of '%s' from webview #%ld.", this->_prerenders[i].uri.c_str(), (uint64_t)this);
+            this->destroy_prerender(i);
+            return;
+        }
+    }
+}
+
+void WebView::destroy_prerender(size_t index)
+{
+    auto p = this->_prerenders[index];
+    this->_prerenders.erase(this->_prerenders.begin() + index);
+
+    g_signal_handlers_disconnect_by_data(p.webview, this);
+    gtk_widget_destroy(p.window);
+}
+
+bool WebView::swap_prerender(const gchar *uri)
+{
+    size_t index = 0;
+    while (index < this->_prerenders.size() && this->_prerenders[index].uri != uri)
+    {
+        index++;
+    }
+
+    if (index == this->_prerenders.size())
+    {
+        return false;
+    }
+
+    if (this->_prerenders[index].failed)
+    {
+        this->destroy_prerender(index);
+        return false;
+    }
+
+    TRACE_SCOPE("swap_prerender");
+
+    auto p = this->_prerenders[index];
+    this->_prerenders.erase(this->_prerenders.begin() + index);
+
+    auto old_widget = GTK_WIDGET(this->_webview);
+    auto widget = GTK_WIDGET(p.webview);
+    auto focused = gtk_widget_has_focus(old_widget);
+
+    int width, height;
+    gtk_widget_get_size_request(old_widget, &width, &height);
+
+    // Take the prerendered view out of its window before it goes away.
+    g_signal_handlers_disconnect_by_data(p.webview, this);
+    g_object_ref(widget);
+    gtk_container_remove(GTK_CONTAINER(p.window), widget);
+    gtk_widget_destroy(p.window);
+
+    // Geometry queued for this view stays pending, it is keyed by the
+    // WebView and the next flush applies it to the new widget.
+    g_signal_handlers_disconnect_by_data(this->_webview, this);
+    g_object_set_data(G_OBJECT(this->_webview), "flutter-webkit-view", NULL);
+    gtk_widget_destroy(old_widget);
+
+    gtk_widget_set_size_request(widget, width, height);
+    if (this->headless())
+    {
+        gtk_container_add(GTK_CONTAINER(this->_offscreen), widget);
+    }
+    else
+    {
+        gtk_fixed_put(this->_host->container(), widget, this->_x, this->_y);
+    }
+    gtk_widget_show(widget);
+    g_object_unref(widget);
+
+    // WebKitGTK can't move back-forward items between views, the session
+    // history starts over with the prerendered page.
+    this->_webview = p.webview;
+    this->connect_signals();
+
+    if (this->_clipped)
+    {
+        auto clip = this->_clip;
+        this->_clipped = false;
+        this->set_clip(&clip);
+    }
+
+    if (focused)
+    {
+        gtk_widget_grab_focus(widget);
+    }
+
+    // The page loaded out of sight, report it to Dart as a regular
+    // navigation. A prerender that is still loading reports the rest itself.
+    this->_sent_load_event = WEBKIT_LOAD_STARTED;
+    this->_sent_progress = 0.0;
+    if (this->_resource_timeline)
+    {
+        this->_resource_timeline->reset();
+    }
+
+    this->send_load_event(WEBKIT_LOAD_STARTED);
+
+    this->_uri_dirty = true;
+    this->_title_dirty = true;
+    this->_progress_dirty = true;
+    this->flush_properties();
+
+    if (!webkit_web_view_is_loading(this->_webview))
+    {
+        this->_sent_load_event = WEBKIT_LOAD_FINISHED;
+        this->send_load_event(WEBKIT_LOAD_FINISHED);
+    }
+
+    LOG_INFO(LOG_WEBVIEW, "Swapped prerender of '%s' into webview #%ld.", uri, (uint64_t)this);
+    return true;
+}
+
+void WebView::register_upload_handler(const gchar *name, const gchar *path)
+{
+    this->_upload_targets[name] = path == NULL ? "" : path;
+}
+
+void WebView::unregister_upload_handler(const gchar *name)
+{
+    this->_upload_targets.erase(name);
+}
+
+void WebView::handle_upload(WebKitURISchemeRequest *request)
+{
+    // flutter-webkit://upload/<name>
+    auto uri = g_uri_parse(webkit_uri_scheme_request_get_uri(request), G_URI_FLAGS_NONE, NULL);
+    std::string name;
+    if (uri != NULL && g_strcmp0(g_uri_get_host(uri), "upload") == 0)
+    {
+        auto path = g_uri_get_path(uri);
+        name = path[0] == '/' ? path + 1 : path;
+    }
+    if (uri != NULL)
+    {
+        g_uri_unref(uri);
+    }
+
+    auto pos = this->_upload_targets.find(name);
+    if (pos == this->_upload_targets.end())
+    {
+        Upload::respond(request, 404, "text/plain", "No upload handler is registered with this name.");
+        return;
+    }
+
+    // Only the page loaded in the view may upload, not frames it embeds from
+    // other origins, see Upload.h.
+    std::string origin;
+    auto page_uri = webkit_web_view_get_uri(this->_webview);
+    if (page_uri == NULL || !WarmUp::origin(page_uri, origin))
+    {
+        origin = "null";
+    }
+
+    Upload::start(request, this->_method_channel, (uint64_t)this, pos->first, pos->second, origin);
+}
+
+void WebView::set_warm_up(WarmUp *warm_up)
+{
+    this->_warm_up = warm_up;
+}
+
+// Downloads are tracked by the DownloadManager, their events still follow
+// the view to the isolate that owns it.
+void WebView::send_download_event(const gchar *method, FlValue *args)
+{
+    this->send_event(method, args);
+}
+
+EventQueue *WebView::events() const
+{
+    return this->_events;
+}
+
+bool WebView::focused() const
+{
+    return gtk_widget_has_focus(GTK_WIDGET(this->_webview));
+}
+
+QualityTier WebView::quality_tier() const
+{
+    return this->_quality_tier;
+}
+
+void WebView::set_quality_tier(QualityTier tier)
+{
+    if (tier == this->_quality_tier)
+    {
+        return;
+    }
+
+    // Prerendered views share these settings and scripts, so they are
+    // swapped in at the same quality.
+    auto settings = webkit_web_view_get_settings(this->_webview);
+    if (this->_quality_tier == QUALITY_TIER_FULL)
+    {
+        this->_smooth_scrolling = webkit_settings_get_enable_smooth_scrolling(settings);
+    }
+    webkit_settings_set_enable_smooth_scrolling(settings, tier >= QUALITY_TIER_NO_SMOOTH_SCROLLING ? FALSE : this->_smooth_scrolling);
+
+    switch (tier)
+    {
+    case QUALITY_TIER_HALF_FRAME_RATE:
+        this->set_frame_interval(1000 / 30);
+        break;
+    case QUALITY_TIER_QUARTER_FRAME_RATE:
+        this->set_frame_interval(1000 / 15);
+        break;
+    default:
+        this->set_frame_interval(0);
+        break;
+    }
+
+    LOG_DEBUG(LOG_WEBVIEW, "Quality of webview #%ld changed from tier %d to %d.\n", (uint64_t)this, this->_quality_tier, tier);
+    this->_quality_tier = tier;
+}
+
+// |interval| is in milliseconds, 0 removes the cap.
+void WebView::set_frame_interval(int interval)
+{
+    auto manager = webkit_web_view_get_user_content_manager(this->_webview);
+
+    // The wrapper stays once installed, it does nothing without an interval.
+    if (interval > 0 && !this->_frame_throttle_installed)
+    {
+        auto script = webkit_user_script_new(frame_throttle_script,
+                                             WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                                             WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+                                             NULL, NULL);
+        webkit_user_content_manager_add_script(manager, script);
+        webkit_user_script_unref(script);
+        webkit_web_view_run_javascript(this->_webview, frame_throttle_script, NULL, NULL, NULL);
+        this->_frame_throttle_installed = true;
+    }
+
+    if (!this->_frame_throttle_installed)
+    {
+        return;
+    }
+
+    if (this->_frame_interval_script != NULL)
+    {
+        webkit_user_content_manager_remove_script(manager, this->_frame_interval_script);
+        webkit_user_script_unref(this->_frame_interval_script);
+        this->_frame_interval_script = NULL;
+    }
+
+    // Pages loaded later pick the interval up from a script, the current
+    // one is updated directly.
+    g_autofree gchar *source = g_strdup_printf("window.__flutterWebkitFrameInterval = %d;", interval);
+    if (interval > 0)
+    {
+        this->_frame_interval_script = webkit_user_script_new(source,
+                                                              WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                                                              WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+                                                              NULL, NULL);
+        webkit_user_content_manager_add_script(manager, this->_frame_interval_script);
+    }
+    webkit_web_view_run_javascript(this->_webview, source, NULL, NULL, NULL);
+}
@@ -4,10 +4,28 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include "EventQueue.h"
+#include "NavigationPolicy.h"
+#include "ResourceTimeline.h"
+#include "WarmUp.h"
+#include "WebViewHost.h"
 
 class WebView;
 
+// Render quality of a view in a window under load, each tier includes the
+// ones before it. Values match the Dart QualityTier enum.
+enum QualityTier
+{
+    QUALITY_TIER_FULL = 0,
+    QUALITY_TIER_NO_SMOOTH_SCROLLING = 1,
+    QUALITY_TIER_HALF_FRAME_RATE = 2,
+    QUALITY_TIER_QUARTER_FRAME_RATE = 3,
+};
+
 typedef struct
 {
     gulong handler_id;
@@ -15,24 +33,111 @@ typedef struct
     WebView *webview;
 } JavascriptCallbackState;
 
+// A page loaded ahead of time in a hidden sibling view.
+typedef struct
+{
+    std::string uri;
+    WebKitWebView *webview;
+    GtkWidget *window;
+    gint64 last_used;
+    bool failed;
+} Prerender;
+
 class WebView
 {
 public:
-    WebView(FlValue *args, FlMethodChannel* method_channel, GtkFixed* container);
+    WebView(FlValue *args, FlMethodChannel* method_channel, FlBasicMessageChannel *binary_channel, WebViewHost* host);
     ~WebView();
 
+    WebViewHost *host() const;
+    FlMethodChannel *channel() const;
+    bool headless() const;
+    void reparent(WebViewHost *host);
     void resize(int width, int height);
     void move(int x, int y);
+    void set_clip(const GdkRectangle *clip);
     void load_uri(const gchar* uri);
-    void evaluate_javascript(uint64_t id, const gchar* script);
+    void evaluate_javascript(uint64_t id, const gchar* script,
+                             FlBasicMessageChannel *reply_channel = NULL,
+                             FlBasicMessageChannelResponseHandle *response_handle = NULL);
     void reload(bool bypass_cache);
+    bool go_back();
+    bool go_forward();
+    bool go_to_index(int index);
+    FlValue *get_back_forward_list();
     bool register_javascript_callback(const gchar* name);
     void unregister_javascript_callback(const gchar* name);
     void open_inspector();
+    void set_navigation_policy(FlValue *rules, NavigationAction default_action, bool fallback);
+    FlValue *get_resource_timeline();
+    bool update_settings(const gchar *preset, FlValue *values);
+    void snapshot(bool full_document, FlMethodCall *method_call);
+    bool prerender(const gchar *uri);
+    void cancel_prerender(const gchar *uri);
+    size_t prerender_count() const;
+    gint64 oldest_prerender() const;
+    void evict_oldest_prerender();
+    void register_upload_handler(const gchar *name, const gchar *path);
+    void unregister_upload_handler(const gchar *name);
+    void handle_upload(WebKitURISchemeRequest *request);
+    void send_download_event(const gchar *method, FlValue *args);
+    void set_warm_up(WarmUp *warm_up);
+    EventQueue *events() const;
+    bool focused() const;
+    QualityTier quality_tier() const;
+    void set_quality_tier(QualityTier tier);
 
 private:
+    void connect_signals();
+    bool swap_prerender(const gchar *uri);
+    void destroy_prerender(size_t index);
+    bool decide_policy(WebKitPolicyDecision *decision, WebKitPolicyDecisionType type);
+    void schedule_property_flush();
+    void flush_properties();
+    void flush_progress();
+    void send_event(const gchar *method, FlValue *args);
+    void send_binary(FlValue *message);
+    void send_load_event(WebKitLoadEvent load_event);
+    void track_resource(WebKitWebResource *resource);
+    void set_frame_interval(int interval);
+
     WebKitWebView *_webview;
-    GtkFixed* _container;
+    WebViewHost* _host;
+    GtkWidget* _offscreen;
     FlMethodChannel* _method_channel;
+    FlBasicMessageChannel *_binary_channel;
+    int _x;
+    int _y;
+    bool _clipped;
+    GdkRectangle _clip;
     std::map<std::string, JavascriptCallbackState> _callback_states;
+    NavigationPolicy _navigation_policy;
+    NavigationAction _default_navigation_action;
+    bool _navigation_fallback;
+
+    guint _property_flush_source;
+    bool _uri_dirty;
+    bool _title_dirty;
+    bool _progress_dirty;
+    gchar *_sent_uri;
+    gchar *_sent_title;
+    int _sent_load_event;
+    double _sent_progress;
+    gint64 _sent_progress_time;
+    double _progress_min_delta;
+    gint64 _progress_interval;
+
+    std::shared_ptr<ResourceTimeline> _resource_timeline;
+    std::vector<Prerender> _prerenders;
+    gchar **_cors_allowlist;
+    std::map<std::string, std::string> _upload_targets;
+    WarmUp *_warm_up;
+    EventQueue *_events;
+    QualityTier _quality_tier;
+    gboolean _smooth_scrolling;
+    bool _frame_throttle_installed;
+    WebKitUserScript *_frame_interval_script;
+    // Cancelled on destruction, async callbacks holding the view check it
+    // before touching it.
+    GCancellable *_cancellable;
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "WebViewHost.h"
+#include "WebView.h"
+
+WebViewHost::WebViewHost(FlMethodChannel *channel, FlBasicMessageChannel *binary_channel, FlView *view)
+    : _channel(channel),
+      _binary_channel(binary_channel),
+      _view(view),
+      _container(nullptr),
+      _pending_geometry(),
+      _tick_callback(0)
+{
+    // Engines without a view can still own webviews placed in other hosts.
+    if (view == NULL)
+    {
+        return;
+    }
+
+    auto overlay = GTK_OVERLAY(gtk_widget_get_parent(GTK_WIDGET(view)));
+    auto fixed = gtk_fixed_new();
+    this->_container = GTK_FIXED(fixed);
+    gtk_overlay_add_overlay(overlay, fixed);
+    gtk_widget_show(fixed);
+
+    gtk_overlay_set_overlay_pass_through(overlay, GTK_WIDGET(view), false);
+    gtk_overlay_set_overlay_pass_through(overlay, GTK_WIDGET(fixed), true);
+
+    // TODO: WebView needs to stay on top until https://github.com/flutter/flutter/issues/66751
+    // is addressed.
+    //
+    // gtk_overlay_reorder_overlay(overlay, GTK_WIDGET(fixed), 0);
+}
+
+WebViewHost::~WebViewHost()
+{
+    if (this->_container != nullptr)
+    {
+        if (this->_tick_callback != 0)
+        {
+            gtk_widget_remove_tick_callback(GTK_WIDGET(this->_container), this->_tick_callback);
+            this->_tick_callback = 0;
+        }
+
+        gtk_widget_destroy(GTK_WIDGET(this->_container));
+        this->_container = nullptr;
+    }
+
+    this->_channel = nullptr;
+    this->_binary_channel = nullptr;
+    this->_view = nullptr;
+}
+
+FlMethodChannel *WebViewHost::channel() const
+{
+    return this->_channel;
+}
+
+FlBasicMessageChannel *WebViewHost::binary_channel() const
+{
+    return this->_binary_channel;
+}
+
+FlView *WebViewHost::view() const
+{
+    return this->_view;
+}
+
+GtkFixed *WebViewHost::container() const
+{
+    return this->_container;
+}
+
+void WebViewHost::set_geometry(WebView *webview, int x, int y, int width, int height, const GdkRectangle *clip)
+{
+    this->_pending_geometry[webview] = Geometry{
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height,
+        .clipped = clip != NULL,
+        .clip = clip != NULL ? *clip : GdkRectangle{0, 0, 0, 0}};
+
+    // An unmapped window has no frames to wait for.
+    auto widget = GTK_WIDGET(this->_container);
+    if (!gtk_widget_get_mapped(widget))
+    {
+        this->flush_geometry();
+        return;
+    }
+
+    if (this->_tick_callback == 0)
+    {
+        this->_tick_callback = gtk_widget_add_tick_callback(
+            widget,
+            +[](GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) -> gboolean
+            {
+                auto self = (WebViewHost *)user_data;
+                self->_tick_callback = 0;
+                self->flush_geometry();
+                return G_SOURCE_REMOVE;
+            },
+            this, NULL);
+    }
+}
+
+void WebViewHost::cancel_geometry(WebView *webview)
+{
+    this->_pending_geometry.erase(webview);
+}
+
+void WebViewHost::flush_geometry()
+{
+    for (auto &e : this->_pending_geometry)
+    {
+        auto &g = e.second;
+        e.first->move(g.x, g.y);
+        e.first->resize(g.width, g.height);
+        e.first->set_clip(g.clipped ? &g.clip : NULL);
+    }
+    this->_pending_geometry.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <map>
+
+class WebView;
+
+// A Flutter view that webviews can be placed in, together with the channels
+// of the engine it belongs to.
+//
+// Geometry updates are batched per host and applied on the next frame of the
+// host's own window, independently of other hosts.
+class WebViewHost
+{
+public:
+    WebViewHost(FlMethodChannel *channel, FlBasicMessageChannel *binary_channel, FlView *view);
+    ~WebViewHost();
+
+    FlMethodChannel *channel() const;
+    FlBasicMessageChannel *binary_channel() const;
+    FlView *view() const;
+    GtkFixed *container() const;
+
+    // |clip| is relative to the webview, NULL if it's not clipped.
+    void set_geometry(WebView *webview, int x, int y, int width, int height, const GdkRectangle *clip);
+    void cancel_geometry(WebView *webview);
+
+private:
+    struct Geometry
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+        bool clipped;
+        GdkRectangle clip;
+    };
+
+    void flush_geometry();
+
+    FlMethodChannel *_channel;
+    FlBasicMessageChannel *_binary_channel;
+    FlView *_view;
+    GtkFixed *_container;
+    std::map<WebView *, Geometry> _pending_geometry;
+    guint _tick_callback;
+};
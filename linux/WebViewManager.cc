@@ -1,46 +1,203 @@
 #include <algorithm>
 #include "WebViewManager.h"
+#include "Log.h"
+#include "Upload.h"
 
 #define FIND_WEBVIEW(id) \
     (std::find(this->_webviews.begin(), this->_webviews.end(), ID_TO_WEBVIEW(id)))
 
 #define ID_TO_WEBVIEW(id) ((WebView *)(void *)id)
 
-WebViewManager::WebViewManager(FlMethodChannel *channel, FlView *fl)
-    : _webviews(), _channel(channel)
+#define FIND_HOST(id) \
+    (std::find(this->_hosts.begin(), this->_hosts.end(), ID_TO_HOST(id)))
+
+#define ID_TO_HOST(id) ((WebViewHost *)(void *)id)
+
+#define DEFAULT_HEADLESS_LIMIT 4
+#define DEFAULT_PRERENDER_LIMIT 2
+
+WebViewManager *WebViewManager::_instance = nullptr;
+
+WebViewManager *WebViewManager::get_instance()
+{
+    if (_instance == nullptr)
+    {
+        _instance = new WebViewManager();
+    }
+
+    return _instance;
+}
+
+WebViewManager::WebViewManager()
+    : _webviews(), _hosts(), _owners(),
+      _headless_count(0), _headless_limit(DEFAULT_HEADLESS_LIMIT),
+      _prerender_limit(DEFAULT_PRERENDER_LIMIT),
+      _memory_monitor(g_memory_monitor_dup_default()),
+      _warm_up(DEFAULT_WARM_UP_RATE, DEFAULT_WARM_UP_WINDOW, DEFAULT_WARM_UP_TTL),
+      _preconnect_view(nullptr),
+      _preconnect_window(nullptr),
+      _preconnect_ready(false),
+      _pending_preconnects(),
+      _downloads(new DownloadManager(webkit_web_context_get_default(), this)),
+      _adaptive_quality(false),
+      _quality()
 {
-    auto overlay = GTK_OVERLAY(gtk_widget_get_parent(GTK_WIDGET(fl)));
-    auto fixed = gtk_fixed_new();
-    this->_container = GTK_FIXED(fixed);
-    gtk_overlay_add_overlay(overlay, fixed);
-    gtk_widget_show(fixed);
+    Upload::register_scheme(webkit_web_context_get_default());
 
-    gtk_overlay_set_overlay_pass_through(overlay, GTK_WIDGET(fl), false);
-    gtk_overlay_set_overlay_pass_through(overlay, GTK_WIDGET(fixed), true);
+    // The page cache is only used with the web browser cache model.
+    webkit_web_context_set_cache_model(webkit_web_context_get_default(), WEBKIT_CACHE_MODEL_WEB_BROWSER);
 
-    // TODO: WebView needs to stay on top until https://github.com/flutter/flutter/issues/66751
-    // is addressed.
-    //
-    // gtk_overlay_reorder_overlay(overlay, GTK_WIDGET(fixed), 0);
+    // Prerenders are speculative, they are the first thing to go when the
+    // system runs low on memory.
+    g_signal_connect(
+        this->_memory_monitor, "low-memory-warning", (GCallback)(+[](GMemoryMonitor *monitor, GMemoryMonitorWarningLevel level, gpointer user_data)
+                                                                 {
+        auto self = (WebViewManager *)user_data;
+        self->drop_prerenders(); }),
+        this);
 }
 
 WebViewManager::~WebViewManager()
 {
+    g_signal_handlers_disconnect_by_data(this->_memory_monitor, this);
+    g_object_unref(this->_memory_monitor);
+
+    delete this->_downloads;
+    this->_downloads = nullptr;
+
+    if (this->_preconnect_window != nullptr)
+    {
+        g_signal_handlers_disconnect_by_data(this->_preconnect_view, this);
+        gtk_widget_destroy(this->_preconnect_window);
+        this->_preconnect_window = nullptr;
+        this->_preconnect_view = nullptr;
+    }
+
+    auto monitored = this->_quality;
+    for (auto &it : monitored)
+    {
+        this->detach_quality_monitor(it.first);
+    }
+
     for (auto i = 0; i < this->_webviews.size(); i++)
     {
         delete this->_webviews.at(i);
     }
     this->_webviews.clear();
+    this->_owners.clear();
+
+    for (auto i = 0; i < this->_hosts.size(); i++)
+    {
+        delete this->_hosts.at(i);
+    }
+    this->_hosts.clear();
+}
+
+WebViewHost *WebViewManager::add_host(FlMethodChannel *channel, FlBasicMessageChannel *binary_channel, FlView *view)
+{
+    auto host = new WebViewHost(channel, binary_channel, view);
+    this->_hosts.push_back(host);
+    LOG_INFO(LOG_MANAGER, "Added host #%ld, %zu hosts total.", (uint64_t)host, this->_hosts.size());
 
-    gtk_widget_destroy(GTK_WIDGET(this->_container));
-    this->_container = nullptr;
+    if (this->_adaptive_quality)
+    {
+        this->attach_quality_monitor(host);
+    }
+    return host;
+}
+
+void WebViewManager::remove_host(WebViewHost *host)
+{
+    auto pos = std::find(this->_hosts.begin(), this->_hosts.end(), host);
+    if (pos == this->_hosts.end())
+    {
+        LOG_WARNING(LOG_MANAGER, "Host #%ld does not exists.\n", (uint64_t)host);
+        return;
+    }
+
+    this->detach_quality_monitor(host);
+
+    // Views owned by the host go away with its engine, views it merely
+    // displays for other engines return to their owner's window.
+    auto webviews = this->_webviews;
+    for (auto webview : webviews)
+    {
+        auto owner = this->_owners[webview];
+        if (owner != host && webview->host() == host && owner->container() != nullptr)
+        {
+            webview->reparent(owner);
+        }
+        else if (owner == host || webview->host() == host)
+        {
+            this->destroy_webview((uint64_t)webview);
+        }
+    }
+
+    this->_hosts.erase(pos);
+    delete host;
+
+    if (this->_hosts.empty())
+    {
+        _instance = nullptr;
+        delete this;
+    }
+}
+
+WebViewHost *WebViewManager::get_host(uint64_t id)
+{
+    auto pos = FIND_HOST(id);
+    if (pos != this->_hosts.end())
+    {
+        return ID_TO_HOST(id);
+    }
+    else
+    {
+        LOG_WARNING(LOG_MANAGER, "Host #%ld does not exists.\n", id);
+        return NULL;
+    }
 }
 
-uint64_t WebViewManager::create_webview(FlValue *args)
+uint64_t WebViewManager::create_webview(FlValue *args, WebViewHost *owner)
 {
-    auto webview = new WebView(args, this->_channel, this->_container);
+    // Headless views don't live in any window and have their own limit, so
+    // background jobs can't pile up.
+    auto arg_headless = fl_value_lookup_string(args, "headless");
+    if (arg_headless != NULL && fl_value_get_type(arg_headless) == FL_VALUE_TYPE_BOOL && fl_value_get_bool(arg_headless))
+    {
+        if (this->_headless_count >= this->_headless_limit)
+        {
+            LOG_WARNING(LOG_MANAGER, "Unable to create headless webview, %d headless views are running already.\n", this->_headless_count);
+            return 0;
+        }
+
+        auto webview = new WebView(args, owner->channel(), owner->binary_channel(), NULL);
+        webview->set_warm_up(&this->_warm_up);
+        this->_webviews.push_back(webview);
+        this->_owners[webview] = owner;
+        this->_headless_count++;
+        LOG_INFO(LOG_MANAGER, "Created headless webview #%ld, %d headless views total.", (uint64_t)webview, this->_headless_count);
+        return (uint64_t)webview;
+    }
+
+    auto host = owner;
+
+    auto arg_host = fl_value_lookup_string(args, "host");
+    if (arg_host != NULL && fl_value_get_type(arg_host) == FL_VALUE_TYPE_INT)
+    {
+        host = this->get_host(fl_value_get_int(arg_host));
+    }
+
+    if (host == NULL || host->container() == nullptr)
+    {
+        LOG_WARNING(LOG_MANAGER, "Unable to create webview, no view to host it.\n");
+        return 0;
+    }
+
+    auto webview = new WebView(args, owner->channel(), owner->binary_channel(), host);
+    webview->set_warm_up(&this->_warm_up);
     this->_webviews.push_back(webview);
-    g_message("Created webview #%ld, %ld views total.", (uint64_t)webview, this->_webviews.size());
+    this->_owners[webview] = owner;
+    LOG_INFO(LOG_MANAGER, "Created webview #%ld in host #%ld, %zu views total.", (uint64_t)webview, (uint64_t)host, this->_webviews.size());
     return (uint64_t)webview;
 }
 
@@ -49,25 +206,389 @@ void WebViewManager::destroy_webview(uint64_t id)
     auto pos = FIND_WEBVIEW(id);
     if (pos != this->_webviews.end())
     {
+        if (ID_TO_WEBVIEW(id)->headless())
+        {
+            this->_headless_count--;
+        }
+        this->_owners.erase(ID_TO_WEBVIEW(id));
         delete ID_TO_WEBVIEW(id);
         this->_webviews.erase(pos);
     }
     else
     {
-        g_warning("Webview #%ld does not exists.\n", id);
+        LOG_WARNING(LOG_MANAGER, "Webview #%ld does not exists.\n", id);
     }
 }
 
 WebView *WebViewManager::get_webview(uint64_t id)
+{
+    auto webview = this->find_webview(id);
+    if (webview == NULL)
+    {
+        LOG_WARNING(LOG_MANAGER, "Webview #%ld does not exists.\n", id);
+    }
+    return webview;
+}
+
+WebView *WebViewManager::find_webview(uint64_t id) const
 {
     auto pos = FIND_WEBVIEW(id);
-    if (pos != this->_webviews.end())
+    return pos != this->_webviews.end() ? ID_TO_WEBVIEW(id) : NULL;
+}
+
+bool WebViewManager::move_webview(uint64_t id, WebViewHost *host)
+{
+    auto webview = this->get_webview(id);
+    if (webview == NULL)
     {
-        return ID_TO_WEBVIEW(id);
+        return false;
     }
-    else
+
+    if (host->container() == nullptr)
     {
-        g_warning("Webview #%ld does not exists.\n", id);
-        return NULL;
+        LOG_WARNING(LOG_MANAGER, "Unable to move webview #%ld, host #%ld has no view.\n", id, (uint64_t)host);
+        return false;
+    }
+
+    if (webview->headless())
+    {
+        LOG_WARNING(LOG_MANAGER, "Unable to move webview #%ld, it's headless.\n", id);
+        return false;
+    }
+
+    webview->reparent(host);
+    LOG_INFO(LOG_MANAGER, "Moved webview #%ld to host #%ld.", id, (uint64_t)host);
+    return true;
+}
+
+
+void WebViewManager::set_headless_limit(int limit)
+{
+    this->_headless_limit = limit;
+}
+
+bool WebViewManager::prerender(uint64_t id, const gchar *uri)
+{
+    auto webview = this->get_webview(id);
+    if (webview == NULL)
+    {
+        return false;
+    }
+
+    if (this->_prerender_limit <= 0)
+    {
+        LOG_WARNING(LOG_MANAGER, "Unable to prerender '%s', prerendering is disabled.\n", uri);
+        return false;
+    }
+
+    auto ok = webview->prerender(uri);
+    this->trim_prerenders(this->_prerender_limit);
+    return ok;
+}
+
+void WebViewManager::set_prerender_limit(int limit)
+{
+    this->_prerender_limit = limit;
+    this->trim_prerenders(limit);
+}
+
+void WebViewManager::drop_prerenders()
+{
+    for (auto webview : this->_webviews)
+    {
+        webview->cancel_prerender(NULL);
     }
-}
\ No newline at end of file
+}
+
+// WebKit doesn't report memory per view, so the budget is a number of
+// prerendered pages across all views. The least recently requested go first.
+void WebViewManager::trim_prerenders(int limit)
+{
+    size_t count = 0;
+    for (auto webview : this->_webviews)
+    {
+        count += webview->prerender_count();
+    }
+
+    while (count > (size_t)std::max(limit, 0))
+    {
+        WebView *victim = nullptr;
+        for (auto webview : this->_webviews)
+        {
+            auto oldest = webview->oldest_prerender();
+            if (oldest >= 0 && (victim == nullptr || oldest < victim->oldest_prerender()))
+            {
+                victim = webview;
+            }
+        }
+
+        victim->evict_oldest_prerender();
+        count--;
+    }
+}
+
+// Resolves the hosts of |uris| and opens connections to their origins ahead
+// of navigation. Returns the number of origins warmed up.
+int WebViewManager::warm_up(FlValue *uris)
+{
+    auto context = webkit_web_context_get_default();
+    auto now = g_get_monotonic_time();
+
+    std::vector<std::string> origins;
+    auto length = fl_value_get_length(uris);
+    for (size_t i = 0; i < length; i++)
+    {
+        auto e = fl_value_get_list_value(uris, i);
+        if (e == NULL || fl_value_get_type(e) != FL_VALUE_TYPE_STRING)
+        {
+            continue;
+        }
+
+        std::string origin;
+        if (this->_warm_up.admit(fl_value_get_string(e), now, origin) != WarmUp::ADMITTED)
+        {
+            continue;
+        }
+
+        auto parsed = g_uri_parse(origin.c_str(), G_URI_FLAGS_NONE, NULL);
+        webkit_web_context_prefetch_dns(context, g_uri_get_host(parsed));
+        g_uri_unref(parsed);
+
+        origins.push_back(origin);
+    }
+
+    if (!origins.empty())
+    {
+        this->preconnect(origins);
+    }
+
+    return origins.size();
+}
+
+// WebKitGTK has no preconnect API. Preconnect hints in a blank page of a
+// hidden view open the connections in the network process every view
+// shares, without touching the DOM of any page the app shows.
+void WebViewManager::preconnect(const std::vector<std::string> &origins)
+{
+    this->_pending_preconnects.insert(this->_pending_preconnects.end(), origins.begin(), origins.end());
+
+    if (this->_preconnect_view == nullptr)
+    {
+        this->_preconnect_view = WEBKIT_WEB_VIEW(webkit_web_view_new());
+        webkit_settings_set_hardware_acceleration_policy(webkit_web_view_get_settings(this->_preconnect_view),
+                                                         WEBKIT_HARDWARE_ACCELERATION_POLICY_NEVER);
+
+        this->_preconnect_window = gtk_offscreen_window_new();
+        gtk_container_add(GTK_CONTAINER(this->_preconnect_window), GTK_WIDGET(this->_preconnect_view));
+        gtk_widget_show_all(this->_preconnect_window);
+
+        g_signal_connect(
+            this->_preconnect_view, "load-changed", (GCallback)(+[](WebKitWebView *web_view, WebKitLoadEvent load_event, gpointer user_data)
+                                                               {
+            auto self = (WebViewManager *)user_data;
+            if (load_event == WEBKIT_LOAD_FINISHED)
+            {
+                self->_preconnect_ready = true;
+                self->flush_preconnects();
+            } }),
+            this);
+
+        webkit_web_view_load_html(this->_preconnect_view, "", "about:blank");
+    }
+
+    if (this->_preconnect_ready)
+    {
+        this->flush_preconnects();
+    }
+}
+
+void WebViewManager::flush_preconnects()
+{
+    if (this->_pending_preconnects.empty())
+    {
+        return;
+    }
+
+    // Hints already in the page have done their job, the connections stay
+    // pooled in the network process.
+    std::string script("(function(o){document.head.replaceChildren();for(const u of o){const l=document.createElement('link');"
+                       "l.rel='preconnect';l.href=u;document.head.appendChild(l);}})([");
+    for (auto &origin : this->_pending_preconnects)
+    {
+        g_autofree gchar *escaped = g_strescape(origin.c_str(), NULL);
+        script += "\"";
+        script += escaped;
+        script += "\",";
+    }
+    script += "]);";
+
+    webkit_web_view_run_javascript(this->_preconnect_view, script.c_str(), NULL, NULL, NULL);
+    this->_warm_up.preconnected(this->_pending_preconnects.size());
+    this->_pending_preconnects.clear();
+}
+
+FlValue *WebViewManager::get_warm_up_stats() const
+{
+    return this->_warm_up.to_fl_value();
+}
+
+DownloadManager *WebViewManager::downloads()
+{
+    return this->_downloads;
+}
+
+// Watches the frame clock of every window while enabled, which keeps the
+// clocks ticking at the display rate.
+void WebViewManager::set_adaptive_quality(bool enabled)
+{
+    if (enabled == this->_adaptive_quality)
+    {
+        return;
+    }
+    this->_adaptive_quality = enabled;
+
+    for (auto host : this->_hosts)
+    {
+        if (enabled)
+        {
+            this->attach_quality_monitor(host);
+        }
+        else
+        {
+            this->detach_quality_monitor(host);
+        }
+    }
+
+    if (!enabled)
+    {
+        for (auto webview : this->_webviews)
+        {
+            webview->set_quality_tier(QUALITY_TIER_FULL);
+        }
+    }
+
+    LOG_INFO(LOG_MANAGER, "Adaptive quality is %s.", enabled ? "enabled" : "disabled");
+}
+
+void WebViewManager::attach_quality_monitor(WebViewHost *host)
+{
+    if (host->container() == nullptr || this->_quality.count(host) != 0)
+    {
+        return;
+    }
+
+    auto tick_id = gtk_widget_add_tick_callback(
+        GTK_WIDGET(host->container()),
+        +[](GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) -> gboolean
+        {
+            auto self = (WebViewManager *)user_data;
+            self->on_frame(widget, clock);
+            return G_SOURCE_CONTINUE;
+        },
+        this, NULL);
+
+    this->_quality.emplace(host, HostQuality{
+                                     tick_id,
+                                     0,
+                                     QualityGovernor(DEFAULT_QUALITY_WINDOW, DEFAULT_QUALITY_OVERLOAD_WINDOWS, DEFAULT_QUALITY_HEADROOM_WINDOWS),
+                                 });
+}
+
+void WebViewManager::detach_quality_monitor(WebViewHost *host)
+{
+    auto pos = this->_quality.find(host);
+    if (pos == this->_quality.end())
+    {
+        return;
+    }
+
+    if (host->container() != nullptr)
+    {
+        gtk_widget_remove_tick_callback(GTK_WIDGET(host->container()), pos->second.tick_id);
+    }
+    this->_quality.erase(pos);
+}
+
+void WebViewManager::on_frame(GtkWidget *container, GdkFrameClock *clock)
+{
+    for (auto &it : this->_quality)
+    {
+        if (GTK_WIDGET(it.first->container()) != container)
+        {
+            continue;
+        }
+
+        auto &quality = it.second;
+        auto now = gdk_frame_clock_get_frame_time(clock);
+
+        gint64 refresh_interval = 0;
+        gdk_frame_clock_get_refresh_info(clock, now, &refresh_interval, NULL);
+        if (refresh_interval <= 0)
+        {
+            refresh_interval = G_USEC_PER_SEC / 60;
+        }
+
+        auto interval = quality.last_frame == 0 ? 0 : now - quality.last_frame;
+        quality.last_frame = now;
+
+        auto decision = quality.governor.frame(interval, refresh_interval);
+        if (decision != QualityGovernor::HOLD)
+        {
+            this->step_quality(it.first, decision);
+        }
+        return;
+    }
+}
+
+// Moves one view of |host| by one tier at a time. Unfocused views are
+// degraded first and restored last, and the lowest tiers go down first so
+// the cost is spread evenly.
+void WebViewManager::step_quality(WebViewHost *host, QualityGovernor::Decision decision)
+{
+    WebView *candidate = nullptr;
+    for (auto webview : this->_webviews)
+    {
+        if (webview->host() != host)
+        {
+            continue;
+        }
+
+        auto tier = webview->quality_tier();
+        if (decision == QualityGovernor::STEP_DOWN)
+        {
+            if (tier == QUALITY_TIER_QUARTER_FRAME_RATE)
+            {
+                continue;
+            }
+            if (candidate == nullptr ||
+                (!webview->focused() && candidate->focused()) ||
+                (webview->focused() == candidate->focused() && tier < candidate->quality_tier()))
+            {
+                candidate = webview;
+            }
+        }
+        else
+        {
+            if (tier == QUALITY_TIER_FULL)
+            {
+                continue;
+            }
+            if (candidate == nullptr ||
+                (webview->focused() && !candidate->focused()) ||
+                (webview->focused() == candidate->focused() && tier > candidate->quality_tier()))
+            {
+                candidate = webview;
+            }
+        }
+    }
+
+    if (candidate == nullptr)
+    {
+        return;
+    }
+
+    auto tier = (QualityTier)(candidate->quality_tier() + (decision == QualityGovernor::STEP_DOWN ? 1 : -1));
+    LOG_INFO(LOG_MANAGER, "Host #%ld is %s, webview #%ld goes to quality tier %d.",
+             (uint64_t)host, decision == QualityGovernor::STEP_DOWN ? "overloaded" : "keeping up", (uint64_t)candidate, tier);
+    candidate->set_quality_tier(tier);
+}
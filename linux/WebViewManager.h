@@ -2,22 +2,76 @@
 
 #include <flutter_linux/flutter_linux.h>
 
+#include <map>
 #include <vector>
 #include <webkitgtk-4.1/webkit2/webkit2.h>
 
+#include "DownloadManager.h"
+#include "QualityGovernor.h"
+#include "WarmUp.h"
 #include "WebView.h"
+#include "WebViewHost.h"
 
+// Process-wide registry of webviews, shared by every engine (and thus every
+// Flutter window) the plugin is registered with.
 class WebViewManager {
     public:
-        WebViewManager(FlMethodChannel *channel, FlView* fl);
-        ~WebViewManager();
-        
-        uint64_t create_webview(FlValue *args);
+        static WebViewManager *get_instance();
+
+        WebViewHost *add_host(FlMethodChannel *channel, FlBasicMessageChannel *binary_channel, FlView *view);
+        void remove_host(WebViewHost *host);
+        WebViewHost *get_host(uint64_t id);
+
+        uint64_t create_webview(FlValue *args, WebViewHost *owner);
         void destroy_webview(uint64_t id);
         WebView* get_webview(uint64_t id);
+        // Like get_webview, without warning when the view is gone.
+        WebView *find_webview(uint64_t id) const;
+        bool move_webview(uint64_t id, WebViewHost *host);
+        void set_headless_limit(int limit);
+        bool prerender(uint64_t id, const gchar *uri);
+        void set_prerender_limit(int limit);
+        void drop_prerenders();
+        int warm_up(FlValue *uris);
+        FlValue *get_warm_up_stats() const;
+        DownloadManager *downloads();
+        void set_adaptive_quality(bool enabled);
 
     private:
+        WebViewManager();
+        ~WebViewManager();
+
+        void trim_prerenders(int limit);
+        void preconnect(const std::vector<std::string> &origins);
+        void flush_preconnects();
+
+        struct HostQuality
+        {
+            guint tick_id;
+            gint64 last_frame;
+            QualityGovernor governor;
+        };
+
+        void attach_quality_monitor(WebViewHost *host);
+        void detach_quality_monitor(WebViewHost *host);
+        void on_frame(GtkWidget *container, GdkFrameClock *clock);
+        void step_quality(WebViewHost *host, QualityGovernor::Decision decision);
+
         std::vector<WebView*> _webviews;
-        GtkFixed* _container;
-        FlMethodChannel *_channel;
-};
\ No newline at end of file
+        std::vector<WebViewHost*> _hosts;
+        std::map<WebView*, WebViewHost*> _owners;
+        int _headless_count;
+        int _headless_limit;
+        int _prerender_limit;
+        GMemoryMonitor *_memory_monitor;
+        WarmUp _warm_up;
+        WebKitWebView *_preconnect_view;
+        GtkWidget *_preconnect_window;
+        bool _preconnect_ready;
+        std::vector<std::string> _pending_preconnects;
+        DownloadManager *_downloads;
+        bool _adaptive_quality;
+        std::map<WebViewHost*, HostQuality> _quality;
+
+        static WebViewManager *_instance;
+};
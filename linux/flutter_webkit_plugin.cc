@@ -4,9 +4,15 @@
 #include <gtk/gtk.h>
 #include <sys/utsname.h>
 
+#include <array>
 #include <cstring>
+#include <string>
+#include <unordered_map>
 
 #include "flutter_webkit_plugin_private.h"
+#include "BinaryProtocol.h"
+#include "Log.h"
+#include "Tracing.h"
 #include "WebViewManager.h"
 
 #define FLUTTER_WEBKIT_PLUGIN(obj)                                     \
@@ -23,13 +29,19 @@ struct _FlutterWebkitPlugin
 {
   GObject parent_instance;
   WebViewManager *manager;
+  WebViewHost *host;
 };
 
 G_DEFINE_TYPE(FlutterWebkitPlugin, flutter_webkit_plugin, g_object_get_type())
 
 static FlMethodResponse *handle_create_webview(FlutterWebkitPlugin *self, FlValue *args)
 {
-  auto id = self->manager->create_webview(args);
+  auto id = self->manager->create_webview(args, self->host);
+  if (id == 0)
+  {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new("create_webview_failed", "Unable to create webview.", NULL));
+  }
+
   g_autoptr(FlValue) result = fl_value_new_int(id);
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
@@ -40,18 +52,52 @@ static FlMethodResponse *handle_destroy_webview(FlutterWebkitPlugin *self, FlVal
   if (arg && fl_value_get_type(arg) == FL_VALUE_TYPE_INT)
   {
     auto id = fl_value_get_int(arg);
-    g_message("Destroying webview #%ld.\n", id);
+    LOG_INFO(LOG_PLUGIN, "Destroying webview #%ld.\n", id);
     self->manager->destroy_webview(id);
   }
   else
   {
-    g_warning("Unable to detroy webview, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to detroy webview, invalid arguments.\n");
   }
 
   g_autoptr(FlValue) result = fl_value_new_null();
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
+static void set_dimension(FlutterWebkitPlugin *self, uint64_t id, int x, int y, int w, int h, const GdkRectangle *clip)
+{
+  auto webview = self->manager->get_webview(id);
+  if (webview == NULL)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set dimension, webview #%ld is not found.\n", id);
+  }
+  else if (webview->headless())
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set dimension, webview #%ld is headless.\n", id);
+  }
+  else
+  {
+    LOG_DEBUG(LOG_PLUGIN, "Setting dimension of webview #%ld to { x = %d, y = %d, w = %d, h = %d }.\n", id, x, y, w, h);
+    webview->host()->set_geometry(webview, x, y, w, h, clip);
+  }
+}
+
+static bool evaluate_javascript(FlutterWebkitPlugin *self, uint64_t webview_id, uint64_t id, const gchar *script,
+                                FlBasicMessageChannel *reply_channel = NULL,
+                                FlBasicMessageChannelResponseHandle *response_handle = NULL)
+{
+  auto webview = self->manager->get_webview(webview_id);
+  if (webview == NULL)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to evaluate javascript, webview #%ld is not found.\n", webview_id);
+    return false;
+  }
+
+  LOG_DEBUG(LOG_PLUGIN, "Evaluating javascript in webview #%ld..\n", id);
+  webview->evaluate_javascript(id, script, reply_channel, response_handle);
+  return true;
+}
+
 static FlMethodResponse *handle_set_dimension(FlutterWebkitPlugin *self, FlValue *args)
 {
   auto arg_id = fl_value_lookup_string(args, "webview");
@@ -69,7 +115,7 @@ static FlMethodResponse *handle_set_dimension(FlutterWebkitPlugin *self, FlValue
       fl_value_get_type(arg_w) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_h) != FL_VALUE_TYPE_INT)
   {
-    g_warning("Unable to set dimension, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to set dimension, invalid arguments.\n");
   }
   else
   {
@@ -79,17 +125,28 @@ static FlMethodResponse *handle_set_dimension(FlutterWebkitPlugin *self, FlValue
     auto w = fl_value_get_int(arg_w);
     auto h = fl_value_get_int(arg_h);
 
-    auto webview = self->manager->get_webview(id);
-    if (webview == NULL)
-    {
-      g_warning("Unable to set dimension, webview #%ld is not found.\n", id);
-    }
-    else
+    // The clip rectangle is optional and relative to the webview.
+    auto arg_clip_x = fl_value_lookup_string(args, "clip_x");
+    auto arg_clip_y = fl_value_lookup_string(args, "clip_y");
+    auto arg_clip_w = fl_value_lookup_string(args, "clip_w");
+    auto arg_clip_h = fl_value_lookup_string(args, "clip_h");
+
+    GdkRectangle clip;
+    auto clipped = arg_clip_x != NULL && arg_clip_y != NULL &&
+                   arg_clip_w != NULL && arg_clip_h != NULL &&
+                   fl_value_get_type(arg_clip_x) == FL_VALUE_TYPE_INT &&
+                   fl_value_get_type(arg_clip_y) == FL_VALUE_TYPE_INT &&
+                   fl_value_get_type(arg_clip_w) == FL_VALUE_TYPE_INT &&
+                   fl_value_get_type(arg_clip_h) == FL_VALUE_TYPE_INT;
+    if (clipped)
     {
-      g_debug("Setting dimension of webview #%ld to { x = %ld, y = %ld, w = %ld, h = %ld }.\n", id, x, y, w, h);
-      webview->move(x, y);
-      webview->resize(w, h);
+      clip.x = fl_value_get_int(arg_clip_x);
+      clip.y = fl_value_get_int(arg_clip_y);
+      clip.width = fl_value_get_int(arg_clip_w);
+      clip.height = fl_value_get_int(arg_clip_h);
     }
+
+    set_dimension(self, id, x, y, w, h, clipped ? &clip : NULL);
   }
 
   g_autoptr(FlValue) result = fl_value_new_null();
@@ -105,7 +162,7 @@ static FlMethodResponse *handle_open(FlutterWebkitPlugin *self, FlValue *args)
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_uri) != FL_VALUE_TYPE_STRING)
   {
-    g_warning("Unable to open URI, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to open URI, invalid arguments.\n");
   }
   else
   {
@@ -115,11 +172,11 @@ static FlMethodResponse *handle_open(FlutterWebkitPlugin *self, FlValue *args)
     auto webview = self->manager->get_webview(id);
     if (webview == NULL)
     {
-      g_warning("Unable to open URI, webview #%ld is not found.\n", id);
+      LOG_WARNING(LOG_PLUGIN, "Unable to open URI, webview #%ld is not found.\n", id);
     }
     else
     {
-      g_message("Opening URI '%s' with webview #%ld..\n", uri, id);
+      LOG_DEBUG(LOG_PLUGIN, "Opening URI '%s' with webview #%ld..\n", uri, id);
       webview->load_uri(uri);
     }
   }
@@ -139,24 +196,11 @@ static FlMethodResponse *handle_evaluate_javascript(FlutterWebkitPlugin *self, F
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_script) != FL_VALUE_TYPE_STRING)
   {
-    g_warning("Unable to evaluate javascript, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to evaluate javascript, invalid arguments.\n");
   }
   else
   {
-    auto webviewId = fl_value_get_int(arg_webview);
-    auto id = fl_value_get_int(arg_id);
-    auto script = fl_value_get_string(arg_script);
-
-    auto webview = self->manager->get_webview(webviewId);
-    if (webview == NULL)
-    {
-      g_warning("Unable to evaluate javascript, webview #%ld is not found.\n", webviewId);
-    }
-    else
-    {
-      g_debug("Evaluating javascript in webview #%ld..\n", id);
-      webview->evaluate_javascript(id, script);
-    }
+    evaluate_javascript(self, fl_value_get_int(arg_webview), fl_value_get_int(arg_id), fl_value_get_string(arg_script));
   }
 
   g_autoptr(FlValue) result = fl_value_new_null();
@@ -172,7 +216,7 @@ static FlMethodResponse *handle_reload(FlutterWebkitPlugin *self, FlValue *args)
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_bypass_cache) != FL_VALUE_TYPE_BOOL)
   {
-    g_warning("Unable to reload, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to reload, invalid arguments.\n");
   }
   else
   {
@@ -182,11 +226,11 @@ static FlMethodResponse *handle_reload(FlutterWebkitPlugin *self, FlValue *args)
     auto webview = self->manager->get_webview(id);
     if (webview == NULL)
     {
-      g_warning("Unable to reload, webview #%ld is not found.\n", id);
+      LOG_WARNING(LOG_PLUGIN, "Unable to reload, webview #%ld is not found.\n", id);
     }
     else
     {
-      g_debug("Reloading webview #%ld, bypass_cache = %s.\n", id, bypass_cache ? "yes" : "no");
+      LOG_DEBUG(LOG_PLUGIN, "Reloading webview #%ld, bypass_cache = %s.\n", id, bypass_cache ? "yes" : "no");
       webview->reload(bypass_cache);
     }
   }
@@ -205,7 +249,7 @@ static FlMethodResponse *handle_register_javascript_callback(FlutterWebkitPlugin
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_name) != FL_VALUE_TYPE_STRING)
   {
-    g_warning("Unable to register javascript callback, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to register javascript callback, invalid arguments.\n");
   }
   else
   {
@@ -215,7 +259,7 @@ static FlMethodResponse *handle_register_javascript_callback(FlutterWebkitPlugin
     auto webview = self->manager->get_webview(id);
     if (webview == NULL)
     {
-      g_warning("Unable to register javascript callback, webview #%ld is not found.\n", id);
+      LOG_WARNING(LOG_PLUGIN, "Unable to register javascript callback, webview #%ld is not found.\n", id);
     }
     else
     {
@@ -236,7 +280,7 @@ static FlMethodResponse *handle_unregister_javascript_callback(FlutterWebkitPlug
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
       fl_value_get_type(arg_name) != FL_VALUE_TYPE_STRING)
   {
-    g_warning("Unable to unregister javascript callback, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to unregister javascript callback, invalid arguments.\n");
   }
   else
   {
@@ -246,7 +290,7 @@ static FlMethodResponse *handle_unregister_javascript_callback(FlutterWebkitPlug
     auto webview = self->manager->get_webview(id);
     if (webview == NULL)
     {
-      g_warning("Unable to register javascript callback, webview #%ld is not found.\n", id);
+      LOG_WARNING(LOG_PLUGIN, "Unable to register javascript callback, webview #%ld is not found.\n", id);
     }
     else
     {
@@ -258,14 +302,15 @@ static FlMethodResponse *handle_unregister_javascript_callback(FlutterWebkitPlug
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static FlMethodResponse *handle_open_inspector(FlutterWebkitPlugin *self, FlValue *args)
+static FlMethodResponse *go_in_history(FlutterWebkitPlugin *self, FlValue *args, bool (WebView::*go)(), const gchar *direction)
 {
   auto arg_id = fl_value_lookup_string(args, "webview");
 
+  bool ret = false;
   if (arg_id == NULL ||
       fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
   {
-    g_warning("Unable to open inspector, invalid arguments.\n");
+    LOG_WARNING(LOG_PLUGIN, "Unable to go %s, invalid arguments.\n", direction);
   }
   else
   {
@@ -274,124 +319,946 @@ static FlMethodResponse *handle_open_inspector(FlutterWebkitPlugin *self, FlValu
     auto webview = self->manager->get_webview(id);
     if (webview == NULL)
     {
-      g_warning("Unable to open inspector, webview #%ld is not found.\n", id);
+      LOG_WARNING(LOG_PLUGIN, "Unable to go %s, webview #%ld is not found.\n", direction, id);
     }
     else
     {
-      webview->open_inspector();
+      ret = (webview->*go)();
     }
   }
 
-  g_autoptr(FlValue) result = fl_value_new_null();
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-// Called when a method call is received from Flutter.
-static void flutter_webkit_plugin_handle_method_call(
-    FlutterWebkitPlugin *self,
-    FlMethodCall *method_call)
+static FlMethodResponse *handle_go_back(FlutterWebkitPlugin *self, FlValue *args)
 {
-  g_autoptr(FlMethodResponse) response = nullptr;
+  return go_in_history(self, args, &WebView::go_back, "back");
+}
 
-  const gchar *method = fl_method_call_get_name(method_call);
-  auto args = fl_method_call_get_args(method_call);
+static FlMethodResponse *handle_go_forward(FlutterWebkitPlugin *self, FlValue *args)
+{
+  return go_in_history(self, args, &WebView::go_forward, "forward");
+}
 
-  if (strcmp(method, "getPlatformVersion") == 0)
-  {
-    response = get_platform_version();
-  }
-  else if (strcmp(method, "create_webview") == 0)
+static FlMethodResponse *handle_go_to_index(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_index = fl_value_lookup_string(args, "index");
+
+  bool ret = false;
+  if (arg_id == NULL || arg_index == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_index) != FL_VALUE_TYPE_INT)
   {
-    response = handle_create_webview(self, args);
+    LOG_WARNING(LOG_PLUGIN, "Unable to go to history index, invalid arguments.\n");
   }
-  else if (strcmp(method, "destroy_webview") == 0)
+  else
   {
-    response = handle_destroy_webview(self, args);
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to go to history index, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      ret = webview->go_to_index(fl_value_get_int(arg_index));
+    }
   }
-  else if (strcmp(method, "set_dimension") == 0)
+
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_get_back_forward_list(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
   {
-    response = handle_set_dimension(self, args);
+    LOG_WARNING(LOG_PLUGIN, "Unable to get back-forward list, invalid arguments.\n");
   }
-  else if (strcmp(method, "open") == 0)
+  else
   {
-    response = handle_open(self, args);
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to get back-forward list, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      g_autoptr(FlValue) result = webview->get_back_forward_list();
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
   }
-  else if (strcmp(method, "evaluate_javascript") == 0)
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_open_inspector(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
   {
-    response = handle_evaluate_javascript(self, args);
+    LOG_WARNING(LOG_PLUGIN, "Unable to open inspector, invalid arguments.\n");
   }
-  else if (strcmp(method, "reload") == 0)
+  else
   {
-    response = handle_reload(self, args);
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to open inspector, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      webview->open_inspector();
+    }
   }
-  else if (strcmp(method, "register_javascript_callback") == 0)
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_set_navigation_rules(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_rules = fl_value_lookup_string(args, "rules");
+  auto arg_default_action = fl_value_lookup_string(args, "default_action");
+  auto arg_fallback = fl_value_lookup_string(args, "fallback");
+
+  if (arg_id == NULL || arg_rules == NULL ||
+      arg_default_action == NULL || arg_fallback == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_rules) != FL_VALUE_TYPE_LIST ||
+      fl_value_get_type(arg_default_action) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_fallback) != FL_VALUE_TYPE_BOOL ||
+      fl_value_get_int(arg_default_action) < NAVIGATION_ACTION_ALLOW ||
+      fl_value_get_int(arg_default_action) > NAVIGATION_ACTION_EXTERNAL)
   {
-    response = handle_register_javascript_callback(self, args);
+    LOG_WARNING(LOG_PLUGIN, "Unable to set navigation rules, invalid arguments.\n");
   }
-  else if (strcmp(method, "unregister_javascript_callback") == 0)
+  else
   {
-    response = handle_unregister_javascript_callback(self, args);
+    auto id = fl_value_get_int(arg_id);
+    auto default_action = (NavigationAction)fl_value_get_int(arg_default_action);
+    auto fallback = fl_value_get_bool(arg_fallback);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to set navigation rules, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      LOG_DEBUG(LOG_PLUGIN, "Setting %ld navigation rules in webview #%ld.\n", fl_value_get_length(arg_rules), id);
+      webview->set_navigation_policy(arg_rules, default_action, fallback);
+    }
   }
-  else if (strcmp(method, "open_inspector") == 0)
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_get_host(FlutterWebkitPlugin *self, FlValue *args)
+{
+  g_autoptr(FlValue) result = fl_value_new_int((uint64_t)self->host);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_move_webview(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_host = fl_value_lookup_string(args, "host");
+
+  bool ret = false;
+  if (arg_id == NULL || arg_host == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_host) != FL_VALUE_TYPE_INT)
   {
-    response = handle_open_inspector(self, args);
+    LOG_WARNING(LOG_PLUGIN, "Unable to move webview, invalid arguments.\n");
   }
   else
   {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    auto id = fl_value_get_int(arg_id);
+    auto host_id = fl_value_get_int(arg_host);
+
+    auto host = self->manager->get_host(host_id);
+    if (host == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to move webview, host #%ld is not found.\n", host_id);
+    }
+    else
+    {
+      ret = self->manager->move_webview(id, host);
+    }
   }
 
-  fl_method_call_respond(method_call, response, nullptr);
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-FlMethodResponse *get_platform_version()
+static FlMethodResponse *handle_update_settings(FlutterWebkitPlugin *self, FlValue *args)
 {
-  struct utsname uname_data = {};
-  uname(&uname_data);
-  g_autofree gchar *version = g_strdup_printf("Linux %s", uname_data.version);
-  g_autoptr(FlValue) result = fl_value_new_string(version);
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_preset = fl_value_lookup_string(args, "preset");
+  auto arg_settings = fl_value_lookup_string(args, "settings");
+
+  bool ret = false;
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      (arg_preset != NULL && fl_value_get_type(arg_preset) != FL_VALUE_TYPE_STRING) ||
+      (arg_settings != NULL && fl_value_get_type(arg_settings) != FL_VALUE_TYPE_MAP))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to update settings, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+    auto preset = arg_preset == NULL ? NULL : fl_value_get_string(arg_preset);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to update settings, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      ret = webview->update_settings(preset, arg_settings);
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static void flutter_webkit_plugin_dispose(GObject *object)
+static FlMethodResponse *handle_set_headless_limit(FlutterWebkitPlugin *self, FlValue *args)
 {
-  delete FLUTTER_WEBKIT_PLUGIN(object)->manager;
-  G_OBJECT_CLASS(flutter_webkit_plugin_parent_class)->dispose(object);
+  auto arg_limit = fl_value_lookup_string(args, "limit");
+
+  if (arg_limit == NULL ||
+      fl_value_get_type(arg_limit) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set headless limit, invalid arguments.\n");
+  }
+  else
+  {
+    self->manager->set_headless_limit(fl_value_get_int(arg_limit));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static void flutter_webkit_plugin_class_init(FlutterWebkitPluginClass *klass)
+static FlMethodResponse *handle_set_adaptive_quality(FlutterWebkitPlugin *self, FlValue *args)
 {
-  G_OBJECT_CLASS(klass)->dispose = flutter_webkit_plugin_dispose;
+  auto arg_enabled = fl_value_lookup_string(args, "enabled");
+
+  if (arg_enabled == NULL ||
+      fl_value_get_type(arg_enabled) != FL_VALUE_TYPE_BOOL)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set adaptive quality, invalid arguments.\n");
+  }
+  else
+  {
+    self->manager->set_adaptive_quality(fl_value_get_bool(arg_enabled));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static void flutter_webkit_plugin_init(FlutterWebkitPlugin *self)
+static FlMethodResponse *handle_get_quality_tier(FlutterWebkitPlugin *self, FlValue *args)
 {
-  self->manager = NULL;
+  auto arg_id = fl_value_lookup_string(args, "webview");
+
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to get quality tier, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to get quality tier, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      g_autoptr(FlValue) result = fl_value_new_int(webview->quality_tier());
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-static void method_call_cb(FlMethodChannel *channel, FlMethodCall *method_call,
-                           gpointer user_data)
+static FlMethodResponse *handle_prerender(FlutterWebkitPlugin *self, FlValue *args)
 {
-  FlutterWebkitPlugin *plugin = FLUTTER_WEBKIT_PLUGIN(user_data);
-  flutter_webkit_plugin_handle_method_call(plugin, method_call);
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_uri = fl_value_lookup_string(args, "uri");
+
+  bool ret = false;
+  if (arg_id == NULL || arg_uri == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_uri) != FL_VALUE_TYPE_STRING)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to prerender, invalid arguments.\n");
+  }
+  else
+  {
+    ret = self->manager->prerender(fl_value_get_int(arg_id), fl_value_get_string(arg_uri));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-void flutter_webkit_plugin_register_with_registrar(FlPluginRegistrar *registrar)
+static FlMethodResponse *handle_cancel_prerender(FlutterWebkitPlugin *self, FlValue *args)
 {
-  FlutterWebkitPlugin *plugin = FLUTTER_WEBKIT_PLUGIN(
-      g_object_new(flutter_webkit_plugin_get_type(), nullptr));
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_uri = fl_value_lookup_string(args, "uri");
 
-  FlView *view = fl_plugin_registrar_get_view(registrar);
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      (arg_uri != NULL && fl_value_get_type(arg_uri) != FL_VALUE_TYPE_STRING &&
+       fl_value_get_type(arg_uri) != FL_VALUE_TYPE_NULL))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to cancel prerender, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+    auto uri = arg_uri == NULL || fl_value_get_type(arg_uri) == FL_VALUE_TYPE_NULL ? NULL : fl_value_get_string(arg_uri);
 
-  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
-  g_autoptr(FlMethodChannel) channel =
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to cancel prerender, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      webview->cancel_prerender(uri);
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_set_prerender_limit(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_limit = fl_value_lookup_string(args, "limit");
+
+  if (arg_limit == NULL ||
+      fl_value_get_type(arg_limit) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set prerender limit, invalid arguments.\n");
+  }
+  else
+  {
+    self->manager->set_prerender_limit(fl_value_get_int(arg_limit));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_register_upload_handler(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_name = fl_value_lookup_string(args, "name");
+  auto arg_path = fl_value_lookup_string(args, "path");
+
+  if (arg_id == NULL || arg_name == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_name) != FL_VALUE_TYPE_STRING ||
+      (arg_path != NULL && fl_value_get_type(arg_path) != FL_VALUE_TYPE_STRING &&
+       fl_value_get_type(arg_path) != FL_VALUE_TYPE_NULL))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to register upload handler, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+    auto path = arg_path == NULL || fl_value_get_type(arg_path) == FL_VALUE_TYPE_NULL ? NULL : fl_value_get_string(arg_path);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to register upload handler, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      webview->register_upload_handler(fl_value_get_string(arg_name), path);
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_unregister_upload_handler(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_name = fl_value_lookup_string(args, "name");
+
+  if (arg_id == NULL || arg_name == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_name) != FL_VALUE_TYPE_STRING)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to unregister upload handler, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to unregister upload handler, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      webview->unregister_upload_handler(fl_value_get_string(arg_name));
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_warm_up(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_uris = fl_value_lookup_string(args, "uris");
+
+  int64_t ret = 0;
+  if (arg_uris == NULL ||
+      fl_value_get_type(arg_uris) != FL_VALUE_TYPE_LIST)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to warm up, invalid arguments.\n");
+  }
+  else
+  {
+    ret = self->manager->warm_up(arg_uris);
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_int(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_get_warm_up_stats(FlutterWebkitPlugin *self, FlValue *args)
+{
+  g_autoptr(FlValue) result = self->manager->get_warm_up_stats();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_set_download_rules(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_rules = fl_value_lookup_string(args, "rules");
+  auto arg_default_directory = fl_value_lookup_string(args, "default_directory");
+  auto arg_cancel_unmatched = fl_value_lookup_string(args, "cancel_unmatched");
+  auto arg_progress_interval = fl_value_lookup_string(args, "progress_interval");
+
+  if (arg_rules == NULL || arg_cancel_unmatched == NULL ||
+      fl_value_get_type(arg_cancel_unmatched) != FL_VALUE_TYPE_BOOL ||
+      fl_value_get_type(arg_rules) != FL_VALUE_TYPE_LIST ||
+      (arg_default_directory != NULL && fl_value_get_type(arg_default_directory) != FL_VALUE_TYPE_STRING &&
+       fl_value_get_type(arg_default_directory) != FL_VALUE_TYPE_NULL) ||
+      (arg_progress_interval != NULL && fl_value_get_type(arg_progress_interval) != FL_VALUE_TYPE_INT))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set download rules, invalid arguments.\n");
+  }
+  else
+  {
+    auto default_directory = arg_default_directory == NULL || fl_value_get_type(arg_default_directory) == FL_VALUE_TYPE_NULL ? NULL : fl_value_get_string(arg_default_directory);
+
+    LOG_DEBUG(LOG_PLUGIN, "Setting %ld download rules.\n", fl_value_get_length(arg_rules));
+    self->manager->downloads()->set_rules(arg_rules, default_directory, fl_value_get_bool(arg_cancel_unmatched));
+    if (arg_progress_interval != NULL)
+    {
+      self->manager->downloads()->set_progress_interval(fl_value_get_int(arg_progress_interval));
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_cancel_download(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_download = fl_value_lookup_string(args, "download");
+
+  bool ret = false;
+  if (arg_download == NULL ||
+      fl_value_get_type(arg_download) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to cancel download, invalid arguments.\n");
+  }
+  else
+  {
+    ret = self->manager->downloads()->cancel(fl_value_get_int(arg_download));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Responds asynchronously once the snapshot is taken.
+static FlMethodResponse *handle_snapshot(FlutterWebkitPlugin *self, FlValue *args, FlMethodCall *method_call)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_full_document = fl_value_lookup_string(args, "full_document");
+
+  if (arg_id == NULL || arg_full_document == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_full_document) != FL_VALUE_TYPE_BOOL)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to take snapshot, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to take snapshot, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      webview->snapshot(fl_value_get_bool(arg_full_document), method_call);
+      return nullptr;
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Held until the view has events, see EventQueue.
+static FlMethodResponse *handle_poll_events(FlutterWebkitPlugin *self, FlValue *args, FlMethodCall *method_call)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to poll events, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL || webview->events() == nullptr)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to poll events, webview #%ld is not found or not owned by a background isolate.\n", id);
+    }
+    else
+    {
+      webview->events()->poll(method_call);
+      return nullptr;
+    }
+  }
+
+  // A null answer ends the poll loop.
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_reply_event(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+  auto arg_request = fl_value_lookup_string(args, "request");
+  auto arg_result = fl_value_lookup_string(args, "result");
+  auto arg_error = fl_value_lookup_string(args, "error");
+
+  // A handler that threw answers with an error, the request fails.
+  if (arg_error != NULL && fl_value_get_type(arg_error) != FL_VALUE_TYPE_NULL)
+  {
+    arg_result = NULL;
+  }
+
+  if (arg_id == NULL || arg_request == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT ||
+      fl_value_get_type(arg_request) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to reply to event, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL || webview->events() == nullptr)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to reply to event, webview #%ld is not found or not owned by a background isolate.\n", id);
+    }
+    else if (!webview->events()->reply(fl_value_get_int(arg_request), arg_result))
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to reply to event, request #%ld is not pending.\n", fl_value_get_int(arg_request));
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_get_resource_timeline(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_id = fl_value_lookup_string(args, "webview");
+
+  if (arg_id == NULL ||
+      fl_value_get_type(arg_id) != FL_VALUE_TYPE_INT)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to get resource timeline, invalid arguments.\n");
+  }
+  else
+  {
+    auto id = fl_value_get_int(arg_id);
+
+    auto webview = self->manager->get_webview(id);
+    if (webview == NULL)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unable to get resource timeline, webview #%ld is not found.\n", id);
+    }
+    else
+    {
+      g_autoptr(FlValue) result = webview->get_resource_timeline();
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_start_tracing(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_path = fl_value_lookup_string(args, "path");
+
+  bool ret = false;
+  if (arg_path == NULL ||
+      fl_value_get_type(arg_path) != FL_VALUE_TYPE_STRING)
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to start tracing, invalid arguments.\n");
+  }
+  else
+  {
+    ret = Tracing::start(fl_value_get_string(arg_path));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_bool(ret);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_stop_tracing(FlutterWebkitPlugin *self, FlValue *args)
+{
+  g_autofree gchar *path = Tracing::stop();
+  g_autoptr(FlValue) result = path == NULL ? fl_value_new_null() : fl_value_new_string(path);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_get_logs(FlutterWebkitPlugin *self, FlValue *args)
+{
+  g_autoptr(FlValue) result = Log::to_fl_value();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse *handle_set_log_level(FlutterWebkitPlugin *self, FlValue *args)
+{
+  auto arg_category = fl_value_lookup_string(args, "category");
+  auto arg_level = fl_value_lookup_string(args, "level");
+
+  if (arg_level == NULL ||
+      fl_value_get_type(arg_level) != FL_VALUE_TYPE_INT ||
+      (arg_category != NULL &&
+       fl_value_get_type(arg_category) != FL_VALUE_TYPE_NULL &&
+       (fl_value_get_type(arg_category) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(arg_category) < 0 ||
+        fl_value_get_int(arg_category) >= LOG_CATEGORY_COUNT)))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set log level, invalid arguments.\n");
+  }
+  else if (arg_category == NULL || fl_value_get_type(arg_category) == FL_VALUE_TYPE_NULL)
+  {
+    Log::set_level(fl_value_get_int(arg_level));
+  }
+  else
+  {
+    Log::set_level((LogCategory)fl_value_get_int(arg_category), fl_value_get_int(arg_level));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+typedef FlMethodResponse *(*MethodHandler)(FlutterWebkitPlugin *self, FlValue *args);
+
+// Responds on its own when returning NULL.
+typedef FlMethodResponse *(*AsyncMethodHandler)(FlutterWebkitPlugin *self, FlValue *args, FlMethodCall *method_call);
+
+typedef struct
+{
+  MethodHandler handler;
+  AsyncMethodHandler async_handler;
+} MethodEntry;
+
+static const std::unordered_map<std::string, MethodEntry> method_handlers = {
+  {"getPlatformVersion", {+[](FlutterWebkitPlugin *self, FlValue *args)
+                          { return get_platform_version(); },
+                          nullptr}},
+  {"create_webview", {handle_create_webview, nullptr}},
+  {"destroy_webview", {handle_destroy_webview, nullptr}},
+  {"set_dimension", {handle_set_dimension, nullptr}},
+  {"open", {handle_open, nullptr}},
+  {"evaluate_javascript", {handle_evaluate_javascript, nullptr}},
+  {"reload", {handle_reload, nullptr}},
+  {"register_javascript_callback", {handle_register_javascript_callback, nullptr}},
+  {"unregister_javascript_callback", {handle_unregister_javascript_callback, nullptr}},
+  {"go_back", {handle_go_back, nullptr}},
+  {"go_forward", {handle_go_forward, nullptr}},
+  {"go_to_index", {handle_go_to_index, nullptr}},
+  {"get_back_forward_list", {handle_get_back_forward_list, nullptr}},
+  {"open_inspector", {handle_open_inspector, nullptr}},
+  {"set_navigation_rules", {handle_set_navigation_rules, nullptr}},
+  {"get_host", {handle_get_host, nullptr}},
+  {"move_webview", {handle_move_webview, nullptr}},
+  {"update_settings", {handle_update_settings, nullptr}},
+  {"set_headless_limit", {handle_set_headless_limit, nullptr}},
+  {"set_adaptive_quality", {handle_set_adaptive_quality, nullptr}},
+  {"get_quality_tier", {handle_get_quality_tier, nullptr}},
+  {"prerender", {handle_prerender, nullptr}},
+  {"cancel_prerender", {handle_cancel_prerender, nullptr}},
+  {"set_prerender_limit", {handle_set_prerender_limit, nullptr}},
+  {"warm_up", {handle_warm_up, nullptr}},
+  {"get_warm_up_stats", {handle_get_warm_up_stats, nullptr}},
+  {"set_download_rules", {handle_set_download_rules, nullptr}},
+  {"cancel_download", {handle_cancel_download, nullptr}},
+  {"register_upload_handler", {handle_register_upload_handler, nullptr}},
+  {"unregister_upload_handler", {handle_unregister_upload_handler, nullptr}},
+  {"snapshot", {nullptr, handle_snapshot}},
+  {"poll_events", {nullptr, handle_poll_events}},
+  {"reply_event", {handle_reply_event, nullptr}},
+  {"get_resource_timeline", {handle_get_resource_timeline, nullptr}},
+  {"start_tracing", {handle_start_tracing, nullptr}},
+  {"stop_tracing", {handle_stop_tracing, nullptr}},
+  {"get_logs", {handle_get_logs, nullptr}},
+  {"set_log_level", {handle_set_log_level, nullptr}},
+};
+
+// Returns true if the handler answers |response_handle| itself.
+typedef bool (*BinaryHandler)(FlutterWebkitPlugin *self, BinaryReader &reader,
+                              FlBasicMessageChannel *channel,
+                              FlBasicMessageChannelResponseHandle *response_handle);
+
+static bool handle_binary_set_dimension(FlutterWebkitPlugin *self, BinaryReader &reader,
+                                        FlBasicMessageChannel *channel,
+                                        FlBasicMessageChannelResponseHandle *response_handle)
+{
+  uint64_t id;
+  int32_t x, y, w, h;
+  uint8_t clipped;
+  GdkRectangle clip;
+
+  if (!reader.u64(&id) ||
+      !reader.i32(&x) || !reader.i32(&y) ||
+      !reader.i32(&w) || !reader.i32(&h) ||
+      !reader.u8(&clipped) ||
+      (clipped && (!reader.i32(&clip.x) || !reader.i32(&clip.y) ||
+                   !reader.i32(&clip.width) || !reader.i32(&clip.height))))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to set dimension, invalid arguments.\n");
+    return false;
+  }
+
+  set_dimension(self, id, x, y, w, h, clipped ? &clip : NULL);
+  return false;
+}
+
+// The result is the reply, so it reaches the isolate that asked for it.
+static bool handle_binary_evaluate_javascript(FlutterWebkitPlugin *self, BinaryReader &reader,
+                                              FlBasicMessageChannel *channel,
+                                              FlBasicMessageChannelResponseHandle *response_handle)
+{
+  uint64_t webview_id, id;
+  if (!reader.u64(&webview_id) || !reader.u64(&id))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to evaluate javascript, invalid arguments.\n");
+    return false;
+  }
+
+  const uint8_t *data;
+  size_t length;
+  reader.rest(&data, &length);
+
+  g_autofree gchar *script = g_strndup((const gchar *)data, length);
+  return evaluate_javascript(self, webview_id, id, script, channel, response_handle);
+}
+
+// Indexed by opcode.
+static const std::array<BinaryHandler, 256> binary_handlers = []()
+{
+  std::array<BinaryHandler, 256> table{};
+  table[BINARY_OP_SET_DIMENSION] = handle_binary_set_dimension;
+  table[BINARY_OP_EVALUATE_JAVASCRIPT] = handle_binary_evaluate_javascript;
+  return table;
+}();
+
+static void binary_message_cb(FlBasicMessageChannel *channel, FlValue *message,
+                              FlBasicMessageChannelResponseHandle *response_handle,
+                              gpointer user_data)
+{
+  auto self = FLUTTER_WEBKIT_PLUGIN(user_data);
+
+  if (message != NULL && fl_value_get_type(message) == FL_VALUE_TYPE_UINT8_LIST &&
+      fl_value_get_length(message) > 0)
+  {
+    BinaryReader reader(fl_value_get_uint8_list(message), fl_value_get_length(message));
+    uint8_t opcode;
+    reader.u8(&opcode);
+
+    TRACE_SCOPE("binary_message");
+
+    auto handler = binary_handlers[opcode];
+    if (handler == nullptr)
+    {
+      LOG_WARNING(LOG_PLUGIN, "Unknown binary opcode 0x%02x.\n", opcode);
+    }
+    else if (handler(self, reader, channel, response_handle))
+    {
+      return;
+    }
+  }
+
+  // Everything else has no result.
+  g_autoptr(GError) err = NULL;
+  if (!fl_basic_message_channel_respond(channel, response_handle, NULL, &err))
+  {
+    LOG_WARNING(LOG_PLUGIN, "Unable to respond to binary message: %s\n", err->message);
+  }
+}
+
+// Called when a method call is received from Flutter.
+static void flutter_webkit_plugin_handle_method_call(
+    FlutterWebkitPlugin *self,
+    FlMethodCall *method_call)
+{
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  const gchar *method = fl_method_call_get_name(method_call);
+  auto args = fl_method_call_get_args(method_call);
+
+  TRACE_SCOPE("method_call", method);
+
+  auto pos = method_handlers.find(method);
+  if (pos == method_handlers.end())
+  {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  else if (pos->second.async_handler != nullptr)
+  {
+    response = pos->second.async_handler(self, args, method_call);
+  }
+  else
+  {
+    response = pos->second.handler(self, args);
+  }
+
+  // Handlers completing asynchronously respond on their own.
+  if (response != nullptr)
+  {
+    fl_method_call_respond(method_call, response, nullptr);
+  }
+}
+
+FlMethodResponse *get_platform_version()
+{
+  struct utsname uname_data = {};
+  uname(&uname_data);
+  g_autofree gchar *version = g_strdup_printf("Linux %s", uname_data.version);
+  g_autoptr(FlValue) result = fl_value_new_string(version);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static void flutter_webkit_plugin_dispose(GObject *object)
+{
+  auto self = FLUTTER_WEBKIT_PLUGIN(object);
+  if (self->manager != NULL)
+  {
+    self->manager->remove_host(self->host);
+    self->manager = NULL;
+    self->host = NULL;
+  }
+  G_OBJECT_CLASS(flutter_webkit_plugin_parent_class)->dispose(object);
+}
+
+static void flutter_webkit_plugin_class_init(FlutterWebkitPluginClass *klass)
+{
+  G_OBJECT_CLASS(klass)->dispose = flutter_webkit_plugin_dispose;
+}
+
+static void flutter_webkit_plugin_init(FlutterWebkitPlugin *self)
+{
+  self->manager = NULL;
+  self->host = NULL;
+}
+
+static void method_call_cb(FlMethodChannel *channel, FlMethodCall *method_call,
+                           gpointer user_data)
+{
+  FlutterWebkitPlugin *plugin = FLUTTER_WEBKIT_PLUGIN(user_data);
+  flutter_webkit_plugin_handle_method_call(plugin, method_call);
+}
+
+void flutter_webkit_plugin_register_with_registrar(FlPluginRegistrar *registrar)
+{
+  Log::init_from_env();
+  Tracing::init_from_env();
+
+  FlutterWebkitPlugin *plugin = FLUTTER_WEBKIT_PLUGIN(
+      g_object_new(flutter_webkit_plugin_get_type(), nullptr));
+
+  FlView *view = fl_plugin_registrar_get_view(registrar);
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel =
       fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
                             "flutter_webkit",
                             FL_METHOD_CODEC(codec));
   fl_method_channel_set_method_call_handler(channel, method_call_cb,
                                             g_object_ref(plugin),
                                             g_object_unref);
-  plugin->manager = new WebViewManager(channel, view);
+
+  // High-frequency calls and events go over their own channel as compact
+  // binary records, see BinaryProtocol.h.
+  g_autoptr(FlBinaryCodec) binary_codec = fl_binary_codec_new();
+  g_autoptr(FlBasicMessageChannel) binary_channel =
+      fl_basic_message_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                   BINARY_CHANNEL,
+                                   FL_MESSAGE_CODEC(binary_codec));
+  fl_basic_message_channel_set_message_handler(binary_channel, binary_message_cb,
+                                               g_object_ref(plugin),
+                                               g_object_unref);
+
+  // Every engine registers the plugin separately, all of them share one
+  // manager so webviews can move between their windows.
+  plugin->manager = WebViewManager::get_instance();
+  plugin->host = plugin->manager->add_host(channel, binary_channel, view);
 
   g_object_unref(plugin);
 }
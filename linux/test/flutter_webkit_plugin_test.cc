@@ -4,6 +4,10 @@
 
 #include "include/flutter_webkit/flutter_webkit_plugin.h"
 #include "flutter_webkit_plugin_private.h"
+#include "Log.h"
+#include "NavigationPolicy.h"
+#include "QualityGovernor.h"
+#include "WarmUp.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -27,5 +31,154 @@ TEST(FlutterWebkitPlugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+static FlValue* navigation_rule(NavigationAction action, const gchar* key,
+                                const gchar* value) {
+  FlValue* rule = fl_value_new_map();
+  fl_value_set_string_take(rule, "action", fl_value_new_int(action));
+  fl_value_set_string_take(rule, key, fl_value_new_string(value));
+  return rule;
+}
+
+TEST(NavigationPolicy, FirstMatchingRuleWins) {
+  g_autoptr(FlValue) rules = fl_value_new_list();
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_BLOCK, "host",
+                                              "*.ads.example.com"));
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_ALLOW, "prefix",
+                                              "https://ads.example.com/ok"));
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_EXTERNAL,
+                                              "scheme", "mailto"));
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_ALLOW, "prefix",
+                                              "https://example.com/"));
+
+  NavigationPolicy policy;
+  policy.compile(rules);
+
+  NavigationAction action;
+  ASSERT_TRUE(policy.evaluate("https://cdn.ads.example.com/x.js", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_BLOCK);
+  ASSERT_TRUE(policy.evaluate("https://ADS.example.com/ok?q=1", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_BLOCK);
+  ASSERT_TRUE(policy.evaluate("mailto:someone@example.com", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_EXTERNAL);
+  ASSERT_TRUE(policy.evaluate("https://example.com:8443/a/b", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_ALLOW);
+  EXPECT_FALSE(policy.evaluate("https://example.com.evil.org/", &action));
+}
+
+TEST(NavigationPolicy, SchemeAndPathMatchAnyHost) {
+  g_autoptr(FlValue) rules = fl_value_new_list();
+  FlValue* rule = navigation_rule(NAVIGATION_ACTION_BLOCK, "scheme", "https");
+  fl_value_set_string_take(rule, "path", fl_value_new_string("/admin"));
+  fl_value_append_take(rules, rule);
+
+  NavigationPolicy policy;
+  policy.compile(rules);
+
+  NavigationAction action;
+  ASSERT_TRUE(policy.evaluate("https://example.com/admin/users", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_BLOCK);
+  ASSERT_TRUE(policy.evaluate("https://other.example.org:8443/admin", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_BLOCK);
+  EXPECT_FALSE(policy.evaluate("http://example.com/admin", &action));
+  EXPECT_FALSE(policy.evaluate("https://example.com/public", &action));
+}
+
+TEST(NavigationPolicy, InvalidRulesAreSkipped) {
+  g_autoptr(FlValue) rules = fl_value_new_list();
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_BLOCK, "regex",
+                                              "(unbalanced"));
+  fl_value_append_take(rules, navigation_rule(NAVIGATION_ACTION_BLOCK, "regex",
+                                              "^https://[^/]*/private/"));
+
+  NavigationPolicy policy;
+  policy.compile(rules);
+
+  NavigationAction action;
+  ASSERT_TRUE(policy.evaluate("https://example.com/private/1", &action));
+  EXPECT_EQ(action, NAVIGATION_ACTION_BLOCK);
+  EXPECT_FALSE(policy.evaluate("https://example.com/public/1", &action));
+}
+
+TEST(WarmUp, DeduplicatesAndRateLimits) {
+  WarmUp warm_up(2, G_TIME_SPAN_SECOND, 60 * G_TIME_SPAN_SECOND);
+  std::string origin;
+
+  EXPECT_EQ(warm_up.admit("https://Example.com/a", 0, origin), WarmUp::ADMITTED);
+  EXPECT_EQ(origin, "https://example.com");
+  EXPECT_EQ(warm_up.admit("https://example.com/b", 1, origin), WarmUp::DEDUPLICATED);
+  EXPECT_EQ(warm_up.admit("https://example.com:8443/", 2, origin), WarmUp::ADMITTED);
+  EXPECT_EQ(origin, "https://example.com:8443");
+  EXPECT_EQ(warm_up.admit("http://127.0.0.1:8080/", 3, origin), WarmUp::RATE_LIMITED);
+  EXPECT_EQ(warm_up.admit("mailto:someone@example.com", 4, origin), WarmUp::INVALID);
+
+  // A new rate window lets more origins through.
+  EXPECT_EQ(warm_up.admit("http://127.0.0.1:8080/", G_TIME_SPAN_SECOND, origin), WarmUp::ADMITTED);
+  EXPECT_EQ(warm_up.warmed(), 3u);
+}
+
+TEST(WarmUp, CountsFirstNavigationWithinTtlAsHit) {
+  WarmUp warm_up(16, G_TIME_SPAN_SECOND, 10 * G_TIME_SPAN_SECOND);
+  std::string origin;
+
+  warm_up.admit("https://a.example.com/", 0, origin);
+  warm_up.admit("https://b.example.com/", 0, origin);
+
+  warm_up.navigated("https://a.example.com/page", G_TIME_SPAN_SECOND);
+  warm_up.navigated("https://a.example.com/other", 2 * G_TIME_SPAN_SECOND);
+  warm_up.navigated("https://c.example.com/", 2 * G_TIME_SPAN_SECOND);
+  EXPECT_EQ(warm_up.used(), 1u);
+
+  // Connections warmed too long ago don't count anymore.
+  warm_up.navigated("https://b.example.com/", 10 * G_TIME_SPAN_SECOND);
+  EXPECT_EQ(warm_up.used(), 1u);
+  EXPECT_EQ(warm_up.warmed(), 2u);
+}
+
+TEST(QualityGovernor, StepsDownUnderSustainedLoadAndBackUpWithHeadroom) {
+  const gint64 refresh = G_USEC_PER_SEC / 60;
+  QualityGovernor governor(10, 2, 3);
+
+  // One overloaded window is not enough.
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(governor.frame(i % 2 ? 2 * refresh : refresh, refresh), QualityGovernor::HOLD);
+  }
+  for (int i = 0; i < 9; i++) {
+    EXPECT_EQ(governor.frame(2 * refresh, refresh), QualityGovernor::HOLD);
+  }
+  EXPECT_EQ(governor.frame(2 * refresh, refresh), QualityGovernor::STEP_DOWN);
+
+  // Idle gaps don't count as frames.
+  EXPECT_EQ(governor.frame(G_USEC_PER_SEC, refresh), QualityGovernor::HOLD);
+
+  auto decision = QualityGovernor::HOLD;
+  for (int i = 0; i < 30; i++) {
+    decision = governor.frame(refresh, refresh);
+    if (i < 29) {
+      EXPECT_EQ(decision, QualityGovernor::HOLD);
+    }
+  }
+  EXPECT_EQ(decision, QualityGovernor::STEP_UP);
+
+  // Frames taking 4 to 10 refresh intervals are the worst overload, not idle.
+  for (int i = 0; i < 19; i++) {
+    EXPECT_EQ(governor.frame((4 + i % 7) * refresh, refresh), QualityGovernor::HOLD);
+  }
+  EXPECT_EQ(governor.frame(10 * refresh, refresh), QualityGovernor::STEP_DOWN);
+}
+
+TEST(Log, RecordsOnlyEnabledLevels) {
+  Log::set_level(LOG_NAVIGATION, LOG_LEVEL_ERROR);
+  LOG_INFO(LOG_NAVIGATION, "dropped");
+  Log::set_level(LOG_NAVIGATION, LOG_LEVEL_DEBUG);
+  LOG_INFO(LOG_NAVIGATION, "kept #%d\n", 1);
+
+  g_autoptr(FlValue) logs = Log::to_fl_value();
+  ASSERT_GT(fl_value_get_length(logs), 0u);
+  FlValue* last = fl_value_get_list_value(logs, fl_value_get_length(logs) - 1);
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(last, "message")), "kept #1");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(last, "level")), LOG_LEVEL_INFO);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(last, "category")), LOG_NAVIGATION);
+}
+
 }  // namespace test
 }  // namespace flutter_webkit
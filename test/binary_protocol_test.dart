@@ -0,0 +1,30 @@
+import 'dart:convert';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:flutter_webkit/src/binary_protocol.dart';
+
+void main() {
+  test('round-trips a multi-field record', () {
+    final data = (BinaryWriter(opSetDimension)
+          ..u64(0x7f0012345678)
+          ..i32(10)
+          ..i32(-20)
+          ..i32(640)
+          ..i32(480)
+          ..u8(1)
+          ..bytes(utf8.encode('tail')))
+        .finish();
+
+    expect(data.lengthInBytes, 1 + 8 + 4 * 4 + 1 + 4);
+
+    final r = BinaryReader(data);
+    expect(r.u8(), opSetDimension);
+    expect(r.u64(), 0x7f0012345678);
+    expect(r.i32(), 10);
+    expect(r.i32(), -20);
+    expect(r.i32(), 640);
+    expect(r.i32(), 480);
+    expect(r.u8(), 1);
+    expect(r.rest(), 'tail');
+  });
+}